@@ -0,0 +1,46 @@
+################ Build options #######################################
+
+NAME		:= gleri
+MAJOR		:= 
+MINOR		:= 
+
+#DEBUG		:= 1
+#USE_USTL	:= 1
+
+################ Programs ############################################
+
+CXX		:= g++
+LD		:= g++
+INSTALL		:= install
+RMPATH		:= rmdir -p --ignore-fail-on-non-empty
+
+INSTALLEXE	:= ${INSTALL} -D -p -m 755 -s
+INSTALLDATA	:= ${INSTALL} -D -p -m 644
+INSTALLLIB	:= ${INSTALL} -D -p -m 644
+
+################ Destination #########################################
+
+BINDIR		:= /usr/local/bin
+LIBDIR		:= /usr/local/lib
+INCDIR		:= /usr/local/include
+
+################ Compiler options ####################################
+
+CXXFLAGS	:= -Wall -Wextra -Woverloaded-virtual -Wpointer-arith\
+		    -Wshadow -Wredundant-decls -Wcast-qual\
+		    -std=c++14 -include string -include limits -I/usr/local/include -I/usr/include/freetype2
+LDFLAGS		:= -L/usr/local/lib
+LIBS		:= -lGL -lX11 -lfreetype -lpng -ljpeg -lz -lpthread
+ifdef USE_USTL
+    LD		:= gcc
+    USTLLIBS	:= -lsupc++
+endif
+ifdef DEBUG
+    CXXFLAGS	+= -O0 -g
+    LDFLAGS	+= -rdynamic
+else
+    CXXFLAGS	+= -Os -g0 -DNDEBUG=1 -ffunction-sections -fdata-sections
+    LDFLAGS	+= -s -Wl,-gc-sections
+endif
+BUILDDIR	:= /tmp/gb/${NAME}
+O		:= .o/
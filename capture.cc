@@ -0,0 +1,123 @@
+// This file is part of the GLERI project
+//
+// Copyright (c) 2012 by Mike Sharov <msharov@users.sourceforge.net>
+// This file is free software, distributed under the MIT License.
+
+#include "capture.h"
+#include "gob.h"
+
+CFrameCapture::CFrameCapture (const char* filename, G::CaptureFmt fmt, G::dim_t w, G::dim_t h, unsigned fps, uint16_t interval)
+: CThread()
+,_f (filename, O_WRONLY| O_CREAT| O_TRUNC| O_CLOEXEC, 0600)
+,_mutex()
+,_cond()
+,_queue()
+,_free()
+,_yuv()
+,_fmt (fmt)
+,_w (w)
+,_h (h)
+,_interval (max<uint16_t> (interval, 1))
+,_nDropped (0)
+,_quitting (false)
+{
+    if (fmt == G::CaptureFmt::Y4M) {
+	char hdr [128];
+	auto hdrsz = snprintf (ArrayBlock(hdr), "YUV4MPEG2 W%hu H%hu F%u:%hu Ip A1:1 C444\n", w, h, fps, _interval);
+	_f.Write (hdr, hdrsz);
+    } else if (fmt != G::CaptureFmt::RAW)
+	XError::emit ("unsupported capture format");
+}
+
+CFrameCapture::~CFrameCapture (void) noexcept
+{
+    Stop();
+    DTRACE ("Capture finished, %u frames dropped\n", _nDropped);
+}
+
+void CFrameCapture::Stop (void) noexcept
+{
+    _mutex.Lock();
+    _quitting = true;
+    _cond.Broadcast();
+    _mutex.Unlock();
+    Join();
+}
+
+/// Queues \p f for writing, replacing it with a previously written buffer.
+/// Returns false if the frame was dropped.
+bool CFrameCapture::Post (framebuf_t& f) noexcept
+{
+    auto queued = false;
+    _mutex.Lock();
+    if (_queue.size() < c_MaxQueued && !_quitting) {
+	_queue.emplace_back();
+	_queue.back().swap (f);
+	if (!_free.empty()) {
+	    f.swap (_free.back());
+	    _free.pop_back();
+	}
+	_cond.Broadcast();
+	queued = true;
+    } else
+	++_nDropped;
+    _mutex.Unlock();
+    return queued;
+}
+
+void CFrameCapture::Run (void)
+{
+    framebuf_t f;
+    _mutex.Lock();
+    for (;;) {
+	while (_queue.empty() && !_quitting)
+	    _cond.Wait (_mutex);
+	if (_queue.empty())
+	    break;	// Queued frames are written before quitting
+	f.swap (_queue.front());
+	_queue.erase (_queue.begin());
+	_mutex.Unlock();
+	try {
+	    WriteFrame (f);
+	} catch (XError& e) {
+	    _mutex.Lock();
+	    _quitting = true;	// Further frames are dropped
+	    _queue.clear();
+	    _mutex.Unlock();
+	    throw;
+	}
+	_mutex.Lock();
+	if (_free.size() < c_MaxQueued) {
+	    _free.emplace_back();
+	    _free.back().swap (f);
+	}
+    }
+    _mutex.Unlock();
+}
+
+void CFrameCapture::WriteFrame (const framebuf_t& f)
+{
+    const auto linesz = _w*3u;
+    if (f.size() < FrameSize())
+	return;
+    if (_fmt == G::CaptureFmt::RAW) {
+	for (auto y = _h; y--;)	// OpenGL rows are bottom-up
+	    _f.Write (&f[y*linesz], linesz);
+	return;
+    }
+    // Y4M frames are planar, with BT.601 studio range components
+    static const char c_FrameHeader[] = "FRAME\n";
+    _f.Write (c_FrameHeader, strlen(c_FrameHeader));
+    const auto planesz = _w*_h;
+    _yuv.resize (3*planesz);
+    auto py = &_yuv[0], pu = py+planesz, pv = pu+planesz;
+    for (auto y = _h; y--;) {
+	for (auto p = &f[y*linesz], pe = p+linesz; p < pe; p += 3) {
+	    int r = p[0], g = p[1], b = p[2];
+	    *py++ = ((66*r + 129*g + 25*b + 128) >> 8) + 16;
+	    *pu++ = ((-38*r - 74*g + 112*b + 128) >> 8) + 128;
+	    *pv++ = ((112*r - 94*g - 18*b + 128) >> 8) + 128;
+	}
+    }
+    _f.Write (&_yuv[0], _yuv.size());
+}
@@ -0,0 +1,44 @@
+// This file is part of the GLERI project
+//
+// Copyright (c) 2012 by Mike Sharov <msharov@users.sourceforge.net>
+// This file is free software, distributed under the MIT License.
+
+#pragma once
+#include "gthread.h"
+#include "gleri/mmfile.h"
+
+/// Writes captured window frames to a video stream file on its own thread.
+///
+/// Frames are packed bottom-up RGB, as read from OpenGL. When the writer
+/// falls behind, new frames are dropped instead of blocking the renderer.
+///
+class CFrameCapture : public CThread {
+public:
+    using framebuf_t	= vector<uint8_t>;
+    enum { c_MaxQueued = 8 };
+public:
+			CFrameCapture (const char* filename, G::CaptureFmt fmt, G::dim_t w, G::dim_t h, unsigned fps, uint16_t interval);
+			~CFrameCapture (void) noexcept;
+    inline G::dim_t	Width (void) const	{ return _w; }
+    inline G::dim_t	Height (void) const	{ return _h; }
+    inline uint16_t	Interval (void) const	{ return _interval; }
+    inline uint32_t	FrameSize (void) const	{ return _w*3u*_h; }
+    bool		Post (framebuf_t& f) noexcept;
+    void		Stop (void) noexcept;
+protected:
+    virtual void	Run (void) override;
+private:
+    void		WriteFrame (const framebuf_t& f);
+private:
+    CFile		_f;
+    CMutex		_mutex;
+    CCondition		_cond;
+    vector<framebuf_t>	_queue;
+    vector<framebuf_t>	_free;		///< Written buffers, returned by Post for reuse
+    framebuf_t		_yuv;
+    G::CaptureFmt	_fmt;
+    G::dim_t		_w,_h;
+    uint16_t		_interval;
+    unsigned		_nDropped;
+    bool		_quitting;
+};
@@ -0,0 +1,30 @@
+// This file is part of the GLERI project
+//
+// Copyright (c) 2012 by Mike Sharov <msharov@users.sourceforge.net>
+// This file is free software, distributed under the MIT License.
+//
+// config.h generated by configure
+#pragma once
+
+#include "gleri/config.h"
+#include <paths.h>
+
+// Queue size when calling listen(3)
+enum { GLERIS_LISTEN_QUEUE_SIZE	= 32 };
+
+// Temporary file name for saving screenshots before sending them to the client
+#define SAVEFB_TMPFILE	_PATH_TMP GLERIS_NAME "_fbXXXXXX.jpg"
+
+// Define to 1 if you have OpenGL
+#if !__has_include(<GL/gl.h>)
+    #error "OpenGL is required to compile this project"
+#endif
+#if !__has_include(<zlib.h>)
+    #error "zlib is required to compile this project"
+#endif
+
+// Global macros turning on library features
+#define GL_GLEXT_PROTOTYPES
+#define GLX_GLXEXT_PROTOTYPES
+#include <GL/gl.h>
+#include <GL/glx.h>
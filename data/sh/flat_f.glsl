@@ -1,6 +1,6 @@
 #version 330 core
 
-uniform vec4 Color;
+layout(std140) uniform DrawState { mat4 Transform; vec4 Color; vec4 Viewport; };
 out vec4 FragColor;
 
 void main() {
@@ -1,6 +1,6 @@
 #version 330 core
 
-uniform mat4 Transform;
+layout(std140) uniform DrawState { mat4 Transform; vec4 Color; vec4 Viewport; };
 layout(location=0) in vec2 Vertex;
 
 void main() {
@@ -1,7 +1,7 @@
 #version 330 core
 
 uniform sampler2D Texture;
-uniform vec4 Color;
+layout(std140) uniform DrawState { mat4 Transform; vec4 Color; vec4 Viewport; };
 in vec2 f_tex;
 out vec4 FragColor;
 
@@ -0,0 +1,17 @@
+#version 330 core
+
+layout(std140) uniform DrawState { mat4 Transform; vec4 Color; vec4 Viewport; };
+uniform vec4 FontTextureSize;
+layout(location=0) in vec4 Vertex;
+layout(location=1) in vec2 TexCoord;
+out vec2 f_tex;
+
+void main() {
+    vec2 corner = vec2(gl_VertexID>>1,gl_VertexID&1);
+    vec4 glyphtl = Transform*vec4(Vertex.xy,1,1);
+    vec4 glyphbr = Transform*vec4(Vertex.xy+Vertex.zw,1,1);
+    vec2 textl = TexCoord.xy+vec2(.5,.5);
+    vec4 tex = vec4(textl,textl+Vertex.zw)/FontTextureSize;
+    gl_Position = vec4(mix(glyphtl.xy,glyphbr.xy,corner),1,1);
+    f_tex = mix(tex.xy,tex.zw,corner);
+}
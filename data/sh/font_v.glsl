@@ -1,6 +1,6 @@
 #version 330 core
 
-uniform mat4 Transform;
+layout(std140) uniform DrawState { mat4 Transform; vec4 Color; vec4 Viewport; };
 uniform vec4 FontTextureSize;
 layout(location=0) in vec4 Vertex;
 layout(location=1) in vec2 TexCoord;
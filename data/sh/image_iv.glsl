@@ -0,0 +1,16 @@
+#version 330 core
+
+layout(std140) uniform DrawState { mat4 Transform; vec4 Color; vec4 Viewport; };
+uniform vec4 TextureSize;
+layout(location=0) in vec4 Vertex;
+layout(location=1) in vec2 TexCoord;
+out vec2 f_tex;
+
+void main() {
+    vec2 corner = vec2(gl_VertexID>>1,gl_VertexID&1);
+    vec4 imgtl = Transform*vec4(Vertex.xy,1,1);
+    vec4 imgbr = Transform*vec4(Vertex.xy+Vertex.zw,1,1);
+    vec4 tex = (vec4(TexCoord,TexCoord+Vertex.zw)*vec4(1,-1,1,-1)+vec4(.5,.5,.5,.5))/TextureSize+vec4(0,1,0,1);
+    gl_Position = vec4(mix(imgtl.xy,imgbr.xy,corner),1,1);
+    f_tex = mix(tex.xy,tex.zw,corner);
+}
@@ -1,14 +1,14 @@
 #version 330 core
 
-uniform mat4 Transform;
-uniform vec4 ImageRect;
-uniform vec4 SpriteRect;
-
+layout(std140) uniform DrawState { mat4 Transform; vec4 Color; vec4 Viewport; };
+uniform vec4 TextureSize;
+layout(location=0) in vec4 Vertex;
+layout(location=1) in vec2 TexCoord;
 out GeomVertex { vec4 pos; vec4 tex; } g;
 
 void main() {
-    vec4 imgtl = Transform*vec4(ImageRect.xy,1,1);
-    vec4 imgbr = Transform*vec4(ImageRect.xy+SpriteRect.zw,1,1);
+    vec4 imgtl = Transform*vec4(Vertex.xy,1,1);
+    vec4 imgbr = Transform*vec4(Vertex.xy+Vertex.zw,1,1);
     g.pos = vec4(imgtl.xy,imgbr.xy);
-    g.tex = (vec4(SpriteRect.xy,SpriteRect.xy+SpriteRect.zw)*vec4(1,-1,1,-1)+vec4(.5,.5,.5,.5))/ImageRect.zwzw+vec4(0,1,0,1);
+    g.tex = (vec4(TexCoord,TexCoord+Vertex.zw)*vec4(1,-1,1,-1)+vec4(.5,.5,.5,.5))/TextureSize+vec4(0,1,0,1);
 }
@@ -0,0 +1,12 @@
+#version 330 core
+
+layout(std140) uniform DrawState { mat4 Transform; vec4 Color; vec4 Viewport; };
+layout(location=0) in vec2 Vertex;
+layout(location=14) in vec2 DrawOffset;
+layout(location=15) in vec4 DrawColor;
+out vec4 f_color;
+
+void main() {
+    gl_Position = Transform*vec4(Vertex,1,1)+vec4(DrawOffset-Transform[3].xy,0,0);
+    f_color = DrawColor;
+}
@@ -0,0 +1,75 @@
+// This file is part of the GLERI project
+//
+// Copyright (c) 2012 by Mike Sharov <msharov@users.sourceforge.net>
+// This file is free software, distributed under the MIT License.
+
+#include "fbsave.h"
+#include "gleris.h"
+
+CFramebufferSave::CFramebufferSave (int fd, iid_t iid, G::goid_t fbid, const char* filename, G::dim_t w, G::dim_t h, G::Texture::Format fmt, uint8_t quality, EncodeSpeed speed, bool passFd)
+: CJob()
+,_tbuf (G::Pixel::RGB, G::Pixel::UNSIGNED_BYTE, w, w*3, h)
+,_filename (filename)
+,_error()
+,_outf()
+,_data (nullptr)
+,_dsz (0)
+,_fd (fd)
+,_iid (iid)
+,_fbid (fbid)
+,_fmt (fmt)
+,_quality (quality)
+,_speed (speed)
+,_passFd (passFd)
+{
+}
+
+CFramebufferSave::~CFramebufferSave (void) noexcept
+{
+    free (_data);
+}
+
+void CFramebufferSave::Run (void) noexcept
+{
+    try {
+	FILE* f;
+	if (_passFd) {
+	    _outf.Open (_filename.c_str(), O_WRONLY| O_CREAT| O_TRUNC| O_CLOEXEC, 0600);
+	    f = fdopen (dup (_outf.Fd()), "wb");	// The original fd is passed to the client
+	} else
+	    f = open_memstream (&_data, &_dsz);
+	if (!f)
+	    CFile::Error (_filename.c_str());
+	try {
+	    CTexture::Encode (f, _tbuf, _fmt, _quality, _speed);
+	} catch (...) {
+	    fclose (f);
+	    throw;
+	}
+	if (0 != fclose (f))
+	    CFile::Error (_filename.c_str());
+    } catch (XError& e) {
+	_error = e.what();
+    }
+    _tbuf = CTexture::CTexBuf();
+}
+
+bool CFramebufferSave::Finish (void) noexcept
+{
+    auto& app = CGleris::Instance();
+    auto pcli = app.ClientRecord (_fd, _iid);
+    if (!pcli)	// Closed since
+	return true;
+    try {
+	if (!_error.empty())
+	    throw XError ("%s", _error.c_str());
+	DTRACE ("[%x] Sending saved framebuffer %s\n", _iid, _filename.c_str());
+	if (_passFd)
+	    pcli->SaveFB (_fbid, _filename.c_str(), _outf);
+	else
+	    pcli->SaveFB (_fbid, _filename.c_str(), _data, _dsz);
+    } catch (XError& e) {
+	app.ForwardError ("SaveFramebuffer", e, _fd, _iid);
+    }
+    return true;
+}
@@ -0,0 +1,39 @@
+// This file is part of the GLERI project
+//
+// Copyright (c) 2012 by Mike Sharov <msharov@users.sourceforge.net>
+// This file is free software, distributed under the MIT License.
+
+#pragma once
+#include "gthread.h"
+#include "gotex.h"
+#include "gleri/cmd.h"
+
+/// Encodes framebuffer pixels read back by SaveFramebuffer on a worker
+/// thread. Locally connected clients get the file written directly and
+/// its fd passed; remote clients get the encoded data from memory.
+///
+class CFramebufferSave : public CWorkerPool::CJob {
+public:
+    using iid_t		= CCmdBuf::iid_t;
+    using EncodeSpeed	= G::Texture::EncodeSpeed;
+public:
+			CFramebufferSave (int fd, iid_t iid, G::goid_t fbid, const char* filename, G::dim_t w, G::dim_t h, G::Texture::Format fmt, uint8_t quality, EncodeSpeed speed, bool passFd);
+			~CFramebufferSave (void) noexcept;
+    inline GLubyte*	Pixels (void)		{ return reinterpret_cast<GLubyte*>(_tbuf.Data()); }
+    virtual void	Run (void) noexcept override;
+    virtual bool	Finish (void) noexcept override;
+private:
+    CTexture::CTexBuf	_tbuf;
+    string		_filename;
+    string		_error;
+    CFile		_outf;	///< The file, when passing fds
+    char*		_data;	///< Encoded data, otherwise
+    size_t		_dsz;
+    int			_fd;
+    iid_t		_iid;
+    G::goid_t		_fbid;
+    G::Texture::Format	_fmt;
+    uint8_t		_quality;
+    EncodeSpeed		_speed;
+    bool		_passFd;
+};
@@ -109,6 +109,19 @@ void CCmdBuf::EndRead (bstri::const_pointer p) noexcept
     memcpy (_buf, p, _used-=br);
 }
 
+/// Like EndRead, but leaves the read buffer to the caller to free,
+/// for messages that must outlive it. Unread data moves to a new one.
+void CCmdBuf::DetachRead (const bstri& is) noexcept
+{
+    assert (is.ipos() >= _buf && is.ipos()+is.remaining() <= _buf+_used && "DetachRead must be given the stream returned by BeginRead");
+    auto unread = is.remaining();
+    _buf = nullptr;
+    _sz = _used = 0;
+    if (unread)
+	memcpy (addspace (unread), is.ipos(), unread);
+    _used = unread;
+}
+
 void CCmdBuf::ReadCmds (void)
 {
     if (!_outf.IsOpen()) return;
@@ -29,6 +29,7 @@ public:
 	inline const_pointer	Msgdata (void) const	{ return (const_pointer)this+hsz; }
 	inline size_type	Msgsize (void) const	{ return hsz+sz; }
 	inline bstri		Msgstrm (void) const	{ return bstri (Msgdata(), sz); }
+	inline bool		Valid (void) const	{ return hsz >= sizeof(*this)+2 && !(hsz%c_MsgAlignment) && !(sz%c_MsgAlignment) && Msgsize() >= sz; }
     };
     struct SDataBlock {
 	const void*	_p;
@@ -88,8 +89,11 @@ public:
     void			WriteCmds (void);
     inline bstri		BeginRead (void) const		{ return bstri(_buf,_used); }
     inline void			EndRead (const bstri& is)	{ EndRead(is.ipos()); }
+    void			DetachRead (const bstri& is) noexcept;
     template <typename OT, typename PT>
-    inline void			ProcessMessages (PT& pp);
+    inline void			ProcessMessages (PT& pp)	{ auto is = BeginRead(); ProcessMessages<OT> (pp, is); EndRead (is); }
+    template <typename OT, typename PT>
+    void			ProcessMessages (PT& pp, bstri& is);
 protected:
     bstro			CreateCmd (uint32_t o, const char* m, size_type msz, size_type sz, size_type unwritten = 0) noexcept;
     void			SendFile (CFile& f, uint32_t fsz);
@@ -144,9 +148,8 @@ void CCmdBuf::Cmd (ECmd cmd, const Arg&... args)
 }
 
 template <typename OT, typename PT>
-void CCmdBuf::ProcessMessages (PT& pp)
+void CCmdBuf::ProcessMessages (PT& pp, bstri& is)
 {
-    auto is = BeginRead();
     while (is.remaining() >sizeof(SMsgHeader)) {// While have commands
 	auto& h = *is.iptr<SMsgHeader>();
 	if (is.remaining() < h.Msgsize())
@@ -162,7 +165,6 @@ void CCmdBuf::ProcessMessages (PT& pp)
 	    pp.ForwardError (h, e, Fd());
 	}
     }
-    EndRead(is);
 }
 
 //----------------------------------------------------------------------
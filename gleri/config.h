@@ -0,0 +1,89 @@
+// This file is part of the GLERI project
+//
+// Copyright (c) 2012 by Mike Sharov <msharov@users.sourceforge.net>
+// This file is free software, distributed under the MIT License.
+//
+// config.h generated by configure
+#pragma once
+
+// Define to the one symbol short name of this package.
+#define GLERI_NAME		"gleri"
+// Define to the numeric version of the package
+#define GLERI_VERSION		0x
+// Define to the protocol version
+#define GLERI_PROTOCOL_VERSION	0
+// Define to the version string of this package.
+#define GLERI_VERSTRING		"918efb4"
+// Define to the address where bug reports for this package should be sent.
+#define GLERI_BUGREPORT		"Mike Sharov <msharov@users.sourceforge.net>"
+
+// Define to the name of the service executable
+#define GLERIS_NAME		"gleris"
+#define GLERIS_SOCKET		"%s/.config/" GLERIS_NAME "-%u.socket"
+#define GLERIS_XDG_SOCKET	"%s/" GLERIS_NAME "-%u.socket"
+#define GLERIS_PORT		6540
+
+// Tweak gcc
+#if !defined(UNUSED)
+    #if __GNUC__
+	#define NORETURN	__attribute((noreturn))
+	#define PURE		__attribute((pure))
+	#define CONST		__attribute((const))
+	#define UNUSED		__attribute((unused))
+    #else
+	#define NORETURN
+	#define PURE
+	#define CONST
+	#define UNUSED
+    #endif
+#endif
+// Other common settings
+#if __i386__ || __x86_64__
+    #define __x86__ 1
+#endif
+
+
+#if __has_include(<ustl.h>)
+    // Define to 1 if you want to use the uSTL library
+    #undef USE_USTL
+#endif
+
+#if USE_USTL
+    #include <ustl.h>
+    using namespace ustl;
+    #if USTL_VERSION < 0x230
+	#error "uSTL version 2.3 is required for this project"
+    #endif
+#else
+    #include <type_traits>
+    #include <algorithm>
+    #include <endian.h>
+    #include <memory>
+    #include <vector>
+    #include <set>
+    using namespace std;
+
+    /// \brief Rounds \p n up to be divisible by \p grain
+    template <typename T>
+    inline constexpr T AlignDown (T n, size_t grain)
+	{ return n - n % grain; }
+
+    /// \brief Rounds \p n up to be divisible by \p grain
+    template <typename T>
+    inline constexpr T Align (T n, size_t grain)
+	{ return AlignDown (n + grain - 1, grain); }
+
+    /// \brief Divides \p n1 by \p n2 and rounds the result up.
+    /// This is in contrast to regular division, which rounds down.
+    template <typename T>
+    inline constexpr T DivRU (T n1, remove_reference_t<T> n2)
+	{ return (n1+(n2-1))/n2; }
+
+    #define foreach(type,i,ctr)	for (type i = (ctr).begin(); i != (ctr).end(); ++ i)
+
+    #define inline	inline __attribute__((always_inline))
+
+    #define USTL_LITTLE_ENDIAN	LITTLE_ENDIAN
+    #define USTL_BIG_ENDIAN	BIG_ENDIAN
+    #define USTL_BYTE_ORDER	BYTE_ORDER
+#endif
@@ -17,6 +17,11 @@ public:
 	uint32_t	size;
     };
     using rangevec_t	= vector<Range>;
+    struct SpriteRect {
+	coord_t		x,y;	///< Destination
+	coord_t		sx,sy;	///< Source rect in the texture
+	dim_t		sw,sh;
+    };
 protected:
     template <typename T, unsigned N> struct ArrayArg {
 	inline constexpr ArrayArg (const T* v = nullptr) :_v(v) {}
@@ -25,6 +30,20 @@ protected:
 	inline void read (bstri& is) { _v = is.iptr<T>(); is.skip (N*sizeof(T)); }
 	const T* _v;
     };
+    template <typename T> struct CountedArrayArg {	// Read in place, like ArrayArg
+	inline constexpr CountedArrayArg (const T* v = nullptr, uint32_t n = 0) :_v(v),_n(n) {}
+	template <typename AAStm>
+	inline void write (AAStm& os) const { os.iwrite (_n); os.write (_v, _n*sizeof(T)); }
+	inline void read (bstri& is) {
+	    is.iread (_n);
+	    if (_n > is.remaining()/sizeof(T))
+		XError::emit ("drawlist parse error");
+	    _v = is.iptr<T>();
+	    is.skip (_n*sizeof(T));
+	}
+	const T* _v;
+	uint32_t _n;
+    };
     enum class ECmd : uint16_t {
 	Clear,
 	Viewport,
@@ -60,6 +79,13 @@ protected:
 	InstancingDivisor,
 	PatchVertices,
 	PointSize,
+	Damage,
+	AnimateColor,
+	AnimateOffset,
+	AnimateUniform,
+	Sprites,
+	UniformBuffer,
+	BindVertexArray,
 	NCmds
     };
 };
@@ -88,27 +114,52 @@ public:
     inline void		Text (coord_t x, coord_t y, const char* s)		{ Cmd (ECmd::Text, x, y, s); }
     inline void		Image (coord_t x, coord_t y, goid_t s)			{ Cmd (ECmd::Image, x, y, s); }
     inline void		Sprite (coord_t x, coord_t y, goid_t s, coord_t sx, coord_t sy, dim_t sw, dim_t sh)	{ Cmd (ECmd::Sprite,x,y,s,sx,sy,sw,sh); }
+			/// Draws n sprites from texture s. Consecutive Image, Sprite, and Sprites
+			/// commands with the same texture are drawn together with one call.
+    inline void		Sprites (goid_t s, const SpriteRect* r, uint32_t n)	{ Cmd (ECmd::Sprites, s, CountedArrayArg<SpriteRect>(r,n)); }
     inline void		Shader (goid_t id)					{ Cmd (ECmd::Shader, id); }
     inline void		DefaultShader (void)					{ Shader (G::default_FlatShader); }
     inline void		Buffer (goid_t id)					{ Cmd (ECmd::BindBuffer, id); }
+			/// Binds a vertex array from CreateVertexArray, replacing Parameter setup
+			/// for client shaders. Parameter calls after it change the vertex array.
+    inline void		VertexArray (goid_t id)					{ Cmd (ECmd::BindVertexArray, id); }
+    inline void		DefaultVertexArray (void)				{ VertexArray (G::GoidNull); }
     inline void		Framebuffer (goid_t id, G::FramebufferType bindas = G::FRAMEBUFFER)	{ Cmd (ECmd::BindFramebuffer, id, uint32_t(bindas)); }
     inline void		DefaultFramebuffer (void)						{ Framebuffer (G::default_Framebuffer, G::FRAMEBUFFER); }
     inline void		FramebufferComponent (goid_t id, const G::FramebufferComponent c)	{ Cmd (ECmd::BindFramebufferComponent, id, c); }
     inline void		FramebufferComponent (goid_t id, goid_t texid)	{ FramebufferComponent (id, G::FramebufferComponent (G::FRAMEBUFFER, G::COLOR_ATTACHMENT0, G::TEXTURE_2D, 0, texid)); }
-    inline void		SaveFramebuffer (coord_t x, coord_t y, dim_t w, dim_t h, const char* filename, G::Texture::Format fmt, uint8_t quality = 100)
-			    { Cmd (ECmd::SaveFramebuffer, x,y,w,h, filename, fmt,quality, G::Pixel::RGB, G::Pixel::UNSIGNED_BYTE, uint16_t(0)); }
+    inline void		SaveFramebuffer (coord_t x, coord_t y, dim_t w, dim_t h, const char* filename, G::Texture::Format fmt, uint8_t quality = 100, G::Texture::EncodeSpeed speed = G::Texture::EncodeSpeed::DEFAULT)
+			    { Cmd (ECmd::SaveFramebuffer, x,y,w,h, filename, fmt,quality, G::Pixel::RGB, G::Pixel::UNSIGNED_BYTE, speed); }
     inline void		Font (goid_t f)					{ Cmd (ECmd::BindFont, f); }
     inline void		Parameter (uint32_t slot, goid_t buf, G::Type type = G::SHORT, uint8_t sz = 2, uint32_t offset = 0, uint16_t stride = 0)	{ Cmd (ECmd::Parameter, uint32_t(1), slot, buf, uint8_t(type-G::Type_BASE), sz, stride, offset); }
     inline void		Parameter (const char* slot, goid_t buf, G::Type type = G::SHORT, uint8_t sz = 2, uint32_t offset = 0, uint16_t stride = 0)	{ Cmd (ECmd::Parameter, slot, buf, uint8_t(type-G::Type_BASE), sz, stride, offset); }
     inline void		InstancingDivisor (uint16_t slot, uint16_t divisor)	{ Cmd (ECmd::InstancingDivisor, slot,divisor); }
     inline void		PatchVertices (uint32_t nv)				{ Cmd (ECmd::PatchVertices, nv); }
     inline void		PointSize (float ps)					{ Cmd (ECmd::PointSize, ps); }
+			/// Declares an area of the window changed since the last frame. Drawing is
+			/// then clipped to the damage when the server has the rest from earlier frames.
+    inline void		Damage (coord_t x, coord_t y, dim_t w, dim_t h)		{ Cmd (ECmd::Damage, x,y,w,h); }
+			/// Animations are evaluated by the server at the present time of each frame.
+			/// While a frame has any, it is redrawn on every vsync without the client.
+			/// Repeating animations keep their phase across frames; ONCE restarts
+			/// when the drawlist changes. A frame without animations stops them.
+    inline void		AnimateColor (color_t from, color_t to, uint32_t periodms, G::Animation a = G::Animation::LOOP)
+			    { Cmd (ECmd::AnimateColor, from, to, periodms, a); }
+    inline void		AnimateOffset (coord_t fx, coord_t fy, coord_t tx, coord_t ty, uint32_t periodms, G::Animation a = G::Animation::LOOP)
+			    { Cmd (ECmd::AnimateOffset, fx,fy, tx,ty, periodms, a); }
+    inline void		AnimateUniform (const char* name, const float* from, const float* to, uint32_t periodms, G::Animation a = G::Animation::LOOP)
+			    { Cmd (ECmd::AnimateUniform, name, ArrayArg<float,4>(from), ArrayArg<float,4>(to), periodms, a); }
     inline void		Uniform (const char* name, float x, float y, float z, float w)	{ Cmd (ECmd::Uniformf, name, x,y,z,w); }
     inline void		Uniformi (const char* name, int x, int y, int z, int w)	{ Cmd (ECmd::Uniformi, name, x,y,z,w); }
     inline void		Uniformv (const char* name, const float* v)		{ Cmd (ECmd::Uniformf, name, ArrayArg<float,4>(v)); }
     inline void		Uniformv (const char* name, const int* v)		{ Cmd (ECmd::Uniformf, name, ArrayArg<int,4>(v)); }
     inline void		Texture (const char* name, goid_t id, uint32_t slot=0)	{ Cmd (ECmd::Uniformt, name, id, slot); }
     inline void		Matrix (const char* name, const float* m)		{ Cmd (ECmd::Uniformm, name, ArrayArg<float,16>(m)); }
+			/// Binds size bytes of buf at offset, or all of it if size is 0, to uniform binding
+			/// point G::ubo_ClientFirst..ubo_ClientLast, and the current shader's block to it.
+			/// Bindings persist across shader switches; built-in shaders use G::ubo_DrawState.
+    inline void		UniformBuffer (const char* block, uint32_t binding, goid_t buf, uint32_t offset = 0, uint32_t size = 0)
+			    { Cmd (ECmd::UniformBuffer, block, binding, buf, offset, size); }
 			// Various drawing methods
     inline void		DrawArrays (G::Shape type, uint32_t start, uint32_t sz)	{ Cmd (ECmd::DrawArrays, type, start, sz); }
     inline void		DrawArraysIndirect (G::Shape type, uint32_t bufoffset = 0)
@@ -195,7 +246,11 @@ void PDraw<Stm>::Parse (F& f, Stm& is) // static
 {
     while (is.remaining() >= sizeof(ECmd)) {
 	ECmd cmd; is >> cmd;
-	if (cmd >= ECmd::BindBuffer && cmd <= ECmd::MultiDrawArraysIndirect)
+	if (cmd != ECmd::Image && cmd != ECmd::Sprite && cmd != ECmd::Sprites)
+	    f.FlushSprites();
+	if (cmd != ECmd::DrawArrays && cmd != ECmd::Offset && cmd != ECmd::Color)
+	    f.FlushDraws();
+	if (cmd >= ECmd::BindBuffer && cmd <= ECmd::MultiDrawElementsIndirect)
 	    f.DrawCmdInit();
 	switch (cmd) {
 	    case ECmd::Clear: { color_t c; Args(is,c); f.Clear(c); } break;
@@ -242,9 +297,9 @@ void PDraw<Stm>::Parse (F& f, Stm& is) // static
 	    case ECmd::MultiDrawElementsIndirect:
 		{ G::Shape t; G::Type it; uint16_t stride; uint32_t n,o; Args(is,t,it,stride,n,o); f.MultiDrawElementsIndirect(t,it,n,stride,o); } break;
 	    case ECmd::SaveFramebuffer: {
-		coord_t x,y; dim_t w,h; const char* filename = nullptr; G::Texture::Format fmt; uint8_t quality; uint16_t pfmt,pcomp,resv;
-		Args (is,x,y,w,h,filename,fmt,quality,pfmt,pcomp,resv);
-		f.SaveFramebuffer (x,y,w,h,filename,fmt,quality);
+		coord_t x,y; dim_t w,h; const char* filename = nullptr; G::Texture::Format fmt; uint8_t quality; uint16_t pfmt,pcomp; G::Texture::EncodeSpeed speed;
+		Args (is,x,y,w,h,filename,fmt,quality,pfmt,pcomp,speed);
+		f.SaveFramebuffer (x,y,w,h,filename,fmt,quality,speed);
 		} break;
 	    case ECmd::InstancingDivisor:
 		{ uint16_t slot,divisor; Args(is,slot,divisor); f.SetInstancingDivisor(slot,divisor); } break;
@@ -252,12 +307,33 @@ void PDraw<Stm>::Parse (F& f, Stm& is) // static
 		{ uint32_t nv; Args(is,nv); f.SetPatchVertices(nv); } break;
 	    case ECmd::PointSize:
 		{ float ps; Args(is,ps); f.SetPointSize(ps); } break;
+	    case ECmd::Damage:
+		{ coord_t x,y; dim_t w,h; Args(is,x,y,w,h); f.Damage(x,y,w,h); } break;
+	    case ECmd::AnimateColor:
+		{ color_t c1,c2; uint32_t p; G::Animation a; Args(is,c1,c2,p,a); f.AnimateColor(c1,c2,p,a); } break;
+	    case ECmd::AnimateOffset:
+		{ coord_t x1,y1,x2,y2; uint32_t p; G::Animation a; Args(is,x1,y1,x2,y2,p,a); f.AnimateOffset(x1,y1,x2,y2,p,a); } break;
+	    case ECmd::AnimateUniform: {
+		const char* name = nullptr; ArrayArg<float,4> v1, v2; uint32_t p; G::Animation a;
+		Args(is,name,v1,v2,p,a);
+		f.AnimateUniform (name, v1._v, v2._v, p, a);
+		} break;
+	    case ECmd::Sprites:
+		{ goid_t s; CountedArrayArg<SpriteRect> r; Args(is,s,r); f.Sprites(f.LookupTexture(s),r._v,r._n); } break;
+	    case ECmd::UniformBuffer: {
+		const char* block = nullptr; uint32_t binding, offset, size; goid_t buf;
+		Args(is,block,binding,buf,offset,size);
+		f.UniformBuffer (block, binding, f.LookupBuffer(buf), offset, size);
+		} break;
+	    case ECmd::BindVertexArray: { goid_t id; Args(is,id); f.BindVertexArray(id); } break;
 	    default: XError::emit ("drawlist parse error");
 	}
 	#ifndef NDEBUG
 	    f.CheckForErrors();
 	#endif
     }
+    f.FlushSprites();
+    f.FlushDraws();
 }
 
 //}}}-------------------------------------------------------------------
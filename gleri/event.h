@@ -17,9 +17,11 @@ public:
 	Destroy,
 	Close,
 	Ping,
-	VSync,
+	VSync,		// key = refresh ns, time = render ns, x = frame seq, y = submit delay ms
 	Focus,
 	Visibility,
+	FrameDropped,	// key = frames dropped so far, x = frame seq
+	PresentMode,	// key = present mode in effect
 	// User input
 	KeyDown,
 	KeyUp,
@@ -138,7 +140,8 @@ namespace KMod {
 enum class Visibility : uint32_t {
     Unobscured,
     PartiallyObscured,
-    FullyObscured
+    FullyObscured,
+    Hidden		///< Unmapped or minimized
 };
 
 enum class ClipboardOp : uint32_t {
@@ -121,6 +121,12 @@ enum StdParameter : uint8_t {
     param_TexCoord = param_Color
 };
 
+enum UniformBinding : uint8_t {
+    ubo_DrawState,	///< Transform, Color, and Viewport of the built-in shaders
+    ubo_ClientFirst,
+    ubo_ClientLast = 35	///< GL_MAX_UNIFORM_BUFFER_BINDINGS is at least 36
+};
+
 enum Feature : uint16_t {
     CAP_BLEND,
     CAP_CULL_FACE,
@@ -159,6 +165,7 @@ enum DefaultResource : goid_t {
     default_TextureShader,
     default_FontShader,
     default_Font,
+    default_MergedDrawShader,
     default_ResourceMaxId = 0x10000
 };
 
@@ -371,6 +378,8 @@ enum Parameter : uint16_t {
     COMPARE_FUNC,
     DEPTH_TEXTURE_MODE,
     GENERATE_MIPMAP,
+    LOAD_MODE,	// Server-side, how image files are decoded; see LoadMode
+    ATLAS,	// Server-side, if nonzero, small RGB(A) images are packed into shared textures
     NPARAMS
 };
 enum Filter : uint16_t {
@@ -407,6 +416,11 @@ enum DepthMode : uint16_t {
     DEPTH_IS_ALPHA	= 0x1906,
     DEPTH_IS_INTENSITY	= 0x8049
 };
+enum LoadMode : uint16_t {
+    LOAD_SYNC,		// Decoded before the next command is processed
+    LOAD_PLACEHOLDER,	// Decoded in the background; drawn blank until TextureInfo is sent
+    LOAD_WAIT		// Decoded in the background; the next Draw waits for it
+};
 
 struct alignas(8) Info {
     Type	type;
@@ -449,6 +463,11 @@ enum class Format : uint8_t {
     PNG,
     GIF
 };
+enum class EncodeSpeed : uint16_t {
+    DEFAULT,
+    FASTEST,	// Least compression, for frequent captures
+    SMALLEST	// Best compression, slowest
+};
 
 } // namespace G::Texture
 
@@ -598,6 +617,32 @@ public:
     inline void			write (bstrs& ss) const	{ ss.iwrite (*this); }
 };
 
+//}}}-------------------------------------------------------------------
+//{{{ Vertex array
+
+/// A vertex attribute of a vertex array, or its index buffer when slot is INDEX_SLOT
+class alignas(4) VertexAttrib {
+public:
+    enum : uint8_t { MAX_SLOTS = 16, INDEX_SLOT = UINT8_MAX };
+public:
+    uint8_t			slot;
+    uint8_t			size;
+    Type			type;
+    uint16_t			stride;
+    uint16_t			divisor;
+    uint32_t			offset;
+    goid_t			buffer;
+public:
+    inline constexpr		VertexAttrib (void)
+				    :slot(param_Vertex),size(2),type(SHORT),stride(0),divisor(0),offset(0),buffer(GoidNull) {}
+    inline constexpr		VertexAttrib (uint8_t _slot, goid_t _buffer, Type _type = SHORT, uint8_t _size = 2, uint32_t _offset = 0, uint16_t _stride = 0, uint16_t _divisor = 0)
+				    :slot(_slot),size(_size),type(_type),stride(_stride),divisor(_divisor),offset(_offset),buffer(_buffer) {}
+    static inline constexpr VertexAttrib Index (goid_t _buffer)	{ return VertexAttrib (INDEX_SLOT, _buffer); }
+    inline void			read (bstri& is)	{ is.iread (*this); }
+    inline void			write (bstro& os) const	{ os.iwrite (*this); }
+    inline void			write (bstrs& ss) const	{ ss.iwrite (*this); }
+};
+
 //}}}-------------------------------------------------------------------
 //{{{ Clipboard
 
@@ -611,6 +656,33 @@ enum class ClipboardFmt : uint32_t {
     UTF8_STRING
 };
 
+//}}}-------------------------------------------------------------------
+//{{{ Capture
+
+enum class CaptureFmt : uint16_t {
+    Y4M,	// YUV4MPEG2 stream with 4:4:4 frames
+    RAW		// Headerless top-down RGB frames
+};
+
+//}}}-------------------------------------------------------------------
+//{{{ PresentMode
+
+enum class PresentMode : uint16_t {
+    VSYNC,	// Each frame is shown for at least one refresh
+    IMMEDIATE,	// Frames are shown when done, possibly tearing
+    ADAPTIVE,	// Like VSYNC, but late frames are shown immediately; falls back to VSYNC
+    MAILBOX	// Like VSYNC, but the client is not throttled and the latest frame wins
+};
+
+//}}}-------------------------------------------------------------------
+//{{{ Animation
+
+enum class Animation : uint32_t {
+    ONCE,	// From start to end once, from when the drawlist is first shown
+    LOOP,	// From start to end, repeating
+    PINGPONG	// From start to end and back, repeating
+};
+
 //}}}-------------------------------------------------------------------
 //{{{ WinInfo
 
@@ -681,14 +753,20 @@ public:
     uint8_t	scrn;
     uint8_t	scrd;
     Cursor	cursor;
+    enum RenderFlag : uint32_t {
+	rflag_None,
+	rflag_DynamicResolution	= (1<<0),	// Render at a reduced scale when frames take longer than the refresh interval
+	rflag_MergeDraws	= (1<<1)	// Merge flat DrawArrays runs into one multidraw; needs OpenGL 4.3
+    };
+    uint32_t	rflags;
 public:
     inline constexpr explicit WinInfo (coord_t _x = 0, coord_t _y = 0, dim_t _w = 1, dim_t _h = 1,
 				uint16_t _parent = 0, uint8_t _mingl = 0x33, uint8_t _maxgl = 0,
-				MSAA _aa = MSAA_OFF, WinType _wtype = type_Normal, WinState _wstate = state_Normal, uint8_t _flags = flag_None)
+				MSAA _aa = MSAA_OFF, WinType _wtype = type_Normal, WinState _wstate = state_Normal, uint8_t _flags = flag_None, uint32_t _rflags = rflag_None)
 				:x(_x),y(_y),w(_w),h(_h)
 				,parent(_parent),mingl(_mingl),maxgl(_maxgl)
 				,aa(_aa),wtype(_wtype),wstate(_wstate),flags(_flags)
-				,wmwid(0),scrw(0),scrh(0),scrmw(0),scrmh(0),dpyn(0),scrn(0),scrd(0),cursor(Cursor::left_ptr) {}
+				,wmwid(0),scrw(0),scrh(0),scrmw(0),scrmh(0),dpyn(0),scrn(0),scrd(0),cursor(Cursor::left_ptr),rflags(_rflags) {}
     inline void read (bstri& is)	{ is.iread (*this); }
     inline void write (bstro& os) const	{ os.iwrite (*this); }
     inline void write (bstrs& ss) const	{ ss.iwrite (*this); }
@@ -700,7 +778,7 @@ public:
 const char* TypeName (Type t) noexcept __attribute__((const));
 const char* ShapeName (Shape s) noexcept __attribute__((const));
 
-#define GLERI_WININFO_SIGNATURE	"(nnqqqyyyyyyuqqqqyyyy)"
+#define GLERI_WININFO_SIGNATURE	"(nnqqqyyyyyyuqqqqyyyyu)"
 
 } // namespace G
 
@@ -10,7 +10,7 @@
 class CMenuEntry : public CWidget {
 public:
     inline		CMenuEntry (PRGL* prgl, const char* text, const char* id, const char* accel = "")
-			    : CWidget(prgl),_text(text),_id(id),_accel(accel),_backrect() {}
+			    : CWidget(prgl),_text(text),_id(id),_accel(accel),_backrect() { SetLayered(); }
     ONWIGDRAWDECL	OnDraw (Drw& drw) const;
     virtual SSize	OnMeasure (void) const override;
     virtual void	OnResize (dim_t w, dim_t h) override;
@@ -31,6 +31,7 @@ public:
     inline explicit	CPopupMenu (iid_t wid, iid_t parent, coord_t x, coord_t y, const char* mdef)	: CWindow(wid), _parent(parent),_border(0),_x(x),_y(y),_mdef(mdef),_items(this) {}
     virtual void	OnInit (void) override;
     virtual void	OnResize (dim_t w, dim_t h) override;
+    virtual void	OnDrawLayers (void) override	{ _items.DrawLayers(); }
     ONDRAWDECL		OnDraw (Drw& drw) const;
     virtual void	OnEvent (const CEvent& e) override;
 protected:
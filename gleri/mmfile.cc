@@ -92,14 +92,22 @@ void CFile::Close (void)
 
 size_t CFile::Read (void* d, size_t dsz)
 {
+    auto br = ReadAvailable (d, dsz);
+    if (!br)
+	close (_fd);
+    return max<ssize_t> (br, 0);
+}
+
+// Unlike Read, does not close the fd on EOF, returning 0.
+// Returns -1 if there is no data available on a nonblocking fd.
+ssize_t CFile::ReadAvailable (void* d, size_t dsz, bool fdPass)
+{
+    if (fdPass)
+	return RecvWithFdPass (d, dsz);
     ssize_t br;
-    while (0 >= (br = read (_fd, d, dsz))) {
-	if (!br) {
-	    close (_fd);
-	    return 0;
-	}
+    while (0 > (br = read (_fd, d, dsz))) {
 	if (errno == EAGAIN)
-	    return 0;
+	    return -1;
 	if (errno != EINTR)
 	    Error ("read");
     }
@@ -201,6 +209,14 @@ void CFile::SendFd (CFile& f)
 }
 
 size_t CFile::ReadWithFdPass (void* p, size_t psz)
+{
+    auto br = RecvWithFdPass (p, psz);
+    if (!br)
+	close (_fd);
+    return max<ssize_t> (br, 0);
+}
+
+ssize_t CFile::RecvWithFdPass (void* p, size_t psz)
 {
     msghdr msg;
 
@@ -220,17 +236,15 @@ size_t CFile::ReadWithFdPass (void* p, size_t psz)
     msg.msg_iovlen = 1;
 
     ssize_t br;
-    while (0 >= (br = recvmsg (_fd, &msg, 0))) {
-	if (!br) {
-	    close (_fd);
-	    return 0;
-	}
+    while (0 > (br = recvmsg (_fd, &msg, 0))) {
 	if (errno == EINTR)
 	    continue;
 	if (errno == EAGAIN)
-	    return 0;
+	    return -1;
 	Error ("recvmsg");
     }
+    if (!br)
+	return 0;
 
     auto cmptr = CMSG_FIRSTHDR(&msg);
     if (cmptr && cmptr->cmsg_type == SCM_RIGHTS && cmptr->cmsg_len >= CMSG_LEN(sizeof(int))) {
@@ -51,6 +51,7 @@ public:
 #endif
     void		SendFd (CFile& f);
     size_t		ReadWithFdPass (void* p, size_t psz);
+    ssize_t		ReadAvailable (void* d, size_t dsz, bool fdPass = false);
     inline void		WaitForRead (void) const noexcept;
     inline void		WaitForWrite (void) const noexcept;
     static void		Error (const char* op) NORETURN;
@@ -60,6 +61,7 @@ protected:
     void		BindStream (const sockaddr* sa, socklen_t sasz, unsigned backlog = c_DefaultBacklog);
     bool		ConnectStream (const sockaddr* sa, socklen_t sasz);
 private:
+    ssize_t		RecvWithFdPass (void* p, size_t psz);
     union fdpassheader {
 	cmsghdr cm;				// Header
 	char control [CMSG_SPACE(sizeof(int))];	// Header+Payload
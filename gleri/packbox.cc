@@ -17,13 +17,17 @@ CPackbox::iterator CPackbox::erase (iterator f, iterator l) noexcept
     auto wf = f.base(), wl = l.base();
     for (auto i = wf; i < wl; ++i)
 	delete *i;
+    Invalidate();
     return _wigv.erase (f.base(), l.base());
 }
 
 ONWIGDRAWIMPL(CPackbox)::OnDraw (Drw& drw) const
 {
+    coord_t ox = _x, oy = _y;
+    if (Flag (f_DrawingLayer))	// The layer's origin is this widget's
+	ox = oy = 0;
     for (const auto w : _wigv) {
-	drw.Viewport (_x+w->_x, _y+w->_y, w->_w, w->_h);
+	drw.Viewport (ox+w->_x, oy+w->_y, w->_w, w->_h);
 	w->Draw (drw);
     }
     drw.ResetViewport();
@@ -40,6 +44,17 @@ CPackbox::SSize CPackbox::OnMeasure (void) const
     return sz;
 }
 
+bool CPackbox::DrawLayers (void)
+{
+    // Child layers are drawn first, for this layer to composite them
+    auto changed = false;
+    for (auto w : _wigv)
+	changed |= w->DrawLayers();
+    if (changed)
+	Invalidate();
+    return CWidget::DrawLayers();
+}
+
 void CPackbox::OnResize (dim_t w, dim_t h)
 {
     CWidget::OnResize (w, h);
@@ -39,14 +39,15 @@ public:
     iterator			FindEnclosing (coord_t x, coord_t y) noexcept;
     size_type			Focus (void) const noexcept;
     void			SetFocus (size_type f) noexcept;
-    inline void			push_back (pointer&& v)				{ _wigv.push_back (move(v)); }
-    inline iterator		insert (iterator ip, pointer v)			{ return _wigv.insert (ip.base(), v); }
-    inline iterator		insert (iterator ip, pointer&& v)		{ return _wigv.insert (ip.base(), move(v)); }
+    inline void			push_back (pointer&& v)				{ Invalidate(); _wigv.push_back (move(v)); }
+    inline iterator		insert (iterator ip, pointer v)			{ Invalidate(); return _wigv.insert (ip.base(), v); }
+    inline iterator		insert (iterator ip, pointer&& v)		{ Invalidate(); return _wigv.insert (ip.base(), move(v)); }
     template <typename W, typename... Args>
     inline iterator		emplace (iterator ip, Args&&... args)		{ return insert (ip.base(), CreateSubWidget<W,Args...>(forward<Args>(args)...)); }
     template <typename W, typename... Args>
     inline void			emplace_back (Args&&... args)			{ push_back (CreateSubWidget<W,Args...>(forward<Args>(args)...)); }
     virtual void		OnResize (dim_t w, dim_t h) override;
+    virtual bool		DrawLayers (void) override;
     ONWIGDRAWDECL		OnDraw (Drw& drw) const;
     virtual SSize		OnMeasure (void) const override;
     virtual void		OnEvent (const CEvent& e) override;
@@ -27,6 +27,8 @@ const char PRGL::_cmdNames[] =
      N(Cursor,"y")
      N(GetClipboard,"uu")
      N(SetClipboard,"ua(us)")
+     N(Capture,"qqs")
+     N(PresentMode,"q")
 ;
 #undef N
 
@@ -37,6 +37,8 @@ private:
 	SetCursor,
 	GetClipboard,
 	SetClipboard,
+	Capture,
+	PresentMode,
 	NCmds,
     };
     //{{{ Serialization helper objects: SShader, SArgv
@@ -81,6 +83,7 @@ public:
 	FRAMEBUFFER,
 	SHADER,
 	FONT,
+	VERTEX_ARRAY,
 	_BUFFER_FIRST = 0x20,
 	BUFFER_VERTEX = _BUFFER_FIRST,
 	BUFFER_INDEX,
@@ -156,10 +159,16 @@ public:
     inline void			SetCursor (G::Cursor c)						{ Cmd(ECmd::SetCursor,c); }
     inline void			GetClipboard (G::Clipboard c = G::Clipboard::PRIMARY, G::ClipboardFmt fmt = G::ClipboardFmt::UTF8_STRING);
     inline void			SetClipboard (const char* v, G::Clipboard c = G::Clipboard::PRIMARY, G::ClipboardFmt fmt = G::ClipboardFmt::UTF8_STRING) __attribute__((nonnull));
+    inline void			Capture (const char* f, G::CaptureFmt fmt = G::CaptureFmt::Y4M, uint16_t interval = 1)	{ Cmd(ECmd::Capture,fmt,interval,f); }
+    inline void			StopCapture (void)						{ Capture (""); }
+    inline void			SetPresentMode (G::PresentMode m)				{ Cmd(ECmd::PresentMode,m); }
     inline goid_t		CreateFramebuffer (const G::FramebufferComponent* pa, unsigned na);
     inline goid_t		CreateFramebuffer (std::initializer_list<G::FramebufferComponent> fbc);
     inline goid_t		CreateFramebuffer (goid_t depthbuffer, goid_t colorbuffer);
     inline void			FreeFramebuffer (goid_t id);
+    inline goid_t		CreateVertexArray (const G::VertexAttrib* pa, unsigned na);
+    inline goid_t		CreateVertexArray (std::initializer_list<G::VertexAttrib> va);
+    inline void			FreeVertexArray (goid_t id);
     inline goid_t		LoadFont (const void* d, uint32_t dsz, uint8_t fontSize = default_FontSize);
     inline goid_t		LoadFont (const char* f, uint8_t fontSize = default_FontSize);
     inline goid_t		LoadFont (goid_t pak, const char* f, uint8_t fontSize = default_FontSize);
@@ -185,6 +194,8 @@ private:
     inline goid_t		GenId (void)			{ return ++_lastid; }
     static inline const char*	LookupCmdName (ECmd cmd, size_type& sz) noexcept;
     static ECmd			LookupCmd (const char* name, size_type bleft) noexcept;
+    static inline bool		CmdUsesContext (ECmd cmd)	{ return cmd >= ECmd::LoadData && cmd <= ECmd::BufferSubData; }
+    static inline bool		CmdUsesSharedObjects (ECmd cmd, bstri is);
 				// Generic loader interface
     inline goid_t		LoadData (EResource dtype, const void* data, uint32_t dsz, uint16_t hint);
     inline goid_t		LoadPakFile (EResource dtype, goid_t pak, const char* filename, uint16_t hint);
@@ -267,6 +278,12 @@ PRGL::goid_t PRGL::CreateFramebuffer (goid_t depthbuffer, goid_t colorbuffer)
 		 {G::FRAMEBUFFER, G::COLOR_ATTACHMENT0, G::TEXTURE_2D, 0, colorbuffer}}); }
 void PRGL::FreeFramebuffer (goid_t id)
     { FreeResource (id, EResource::FRAMEBUFFER); }
+PRGL::goid_t PRGL::CreateVertexArray (const G::VertexAttrib* pa, unsigned na)
+    { return LoadData (EResource::VERTEX_ARRAY, pa, na*sizeof(G::VertexAttrib), 0); }
+PRGL::goid_t PRGL::CreateVertexArray (std::initializer_list<G::VertexAttrib> va)
+    { return CreateVertexArray (va.begin(), va.size()); }
+void PRGL::FreeVertexArray (goid_t id)
+    { FreeResource (id, EResource::VERTEX_ARRAY); }
 
 PRGL::goid_t PRGL::LoadFont (const void* d, uint32_t dsz, uint8_t fontSize)
     { return LoadData (EResource::FONT, d, dsz, fontSize); }
@@ -296,6 +313,18 @@ PRGL::goid_t PRGL::LoadShader (goid_t pak, const char* v, const char* f)
 void PRGL::FreeShader (goid_t id)
     { FreeResource (id, EResource::SHADER); }
 
+/// All objects but framebuffers and vertex arrays are shared between contexts
+bool PRGL::CmdUsesSharedObjects (ECmd cmd, bstri is) // static
+{
+    if (cmd == ECmd::BufferSubData)
+	return true;
+    if (cmd < ECmd::LoadData || cmd > ECmd::LoadPakFile)
+	return false;	// The type given to FreeResource is not checked
+    goid_t id; EResource dtype;
+    Args (is, id, dtype);
+    return dtype != EResource::FRAMEBUFFER && dtype != EResource::VERTEX_ARRAY;
+}
+
 //}}}-------------------------------------------------------------------
 //{{{ The read parser
 
@@ -307,6 +336,16 @@ void PRGL::Parse (F& f, const SMsgHeader& h, CCmdBuf& cmdbuf) // static
     auto cmd = LookupCmd (h.Cmdname(), h.hsz);
     if ((clir && cmd == ECmd::Auth) || (!clir && cmd != ECmd::Open && cmd != ECmd::Auth))
 	return f.OnNoClient (h);
+    // Only commands touching GL state need a context. Draw activates
+    // the window itself when it draws right away, and objects shared
+    // between contexts can be loaded in whichever one is current.
+    auto usesgl = clir && CmdUsesContext (cmd);
+    if (usesgl) {
+	if (CmdUsesSharedObjects (cmd, cmdis))
+	    f.ActivateForSharedObjects (*clir);
+	else
+	    f.ActivateClient (*clir);
+    }
 
     switch (cmd) {
 	case ECmd::Auth: {
@@ -322,8 +361,10 @@ void PRGL::Parse (F& f, const SMsgHeader& h, CCmdBuf& cmdbuf) // static
 	    Args (cmdis, winfo, title);
 	    if (clir)
 		f.ResizeClient (*clir, winfo, title);
-	    else
+	    else {
 		clir = f.CreateClient (h.iid, winfo, title, &cmdbuf);
+		usesgl = true;	// CreateClient activates the new context
+	    }
 	    } break;
 	case ECmd::Close:
 	    f.CloseClient (clir);
@@ -391,11 +432,21 @@ void PRGL::Parse (F& f, const SMsgHeader& h, CCmdBuf& cmdbuf) // static
 	    Args (cmdis, ci, nfmts, fmt, d);
 	    f.ClientSetClipboard (*clir, ci, fmt, d);
 	    } break;
+	case ECmd::Capture: {
+	    G::CaptureFmt fmt; uint16_t interval; const char* filename = nullptr;
+	    Args (cmdis, fmt, interval, filename);
+	    f.ClientCapture (*clir, fmt, interval, filename);
+	    } break;
+	case ECmd::PresentMode: {
+	    G::PresentMode m;
+	    Args (cmdis, m);
+	    f.ClientPresentMode (*clir, m);
+	    } break;
 	default:
 	    XError::emit ("invalid protocol command");
 	    break;
     }
-    if (clir)
+    if (usesgl)
 	clir->CheckForErrors();
 }
 
@@ -34,6 +34,8 @@ public:
     inline void			Draw (void)			{ Cmd(ECmd::Draw); }
     inline void			Event (const CEvent& e)		{ Cmd(ECmd::Event,e); }
     void			SaveFB (goid_t id, const char* filename, CFile& f);
+    inline void			SaveFB (goid_t id, const char* filename, const void* d, uint32_t dsz)
+				    { Cmd (ECmd::SaveFBData, id, filename, dsz, uint32_t(0), SDataBlock(d,dsz)); }
     template <typename RInfo>
     inline void			ResourceInfo (goid_t id, uint16_t type, const RInfo& ri);
     inline void			ClipboardData (const char* v, G::Clipboard c = G::Clipboard::PRIMARY, G::ClipboardFmt fmt = G::ClipboardFmt::UTF8_STRING);
@@ -18,3 +18,61 @@ void CWidget::OnEvent (const CEvent& e)
 	default:			break;
     }
 }
+
+void CWidget::OnResize (dim_t w, dim_t h)
+{
+    auto resized = (w != _w || h != _h);
+    _w = w; _h = h;
+    Invalidate();
+    if (resized && Layered())
+	CreateLayer();
+}
+
+//{{{ Layers -----------------------------------------------------------
+
+/// Caches the widget's drawing in a framebuffer, redrawn only when changed
+void CWidget::SetLayered (bool v)
+{
+    if (v == Layered())
+	return;
+    SetFlag (f_Layered, v);
+    if (v && _w && _h)
+	CreateLayer();
+    else if (!v)
+	FreeLayer();
+    Invalidate();
+}
+
+void CWidget::CreateLayer (void)
+{
+    FreeLayer();
+    _layerTex = CreateTexture (G::TEXTURE_2D, _w, _h, 0, G::Pixel::RGBA);
+    _layerFb = CreateFramebuffer ({{G::FRAMEBUFFER, G::COLOR_ATTACHMENT0, G::TEXTURE_2D, 0, _layerTex}});
+}
+
+void CWidget::FreeLayer (void)
+{
+    if (_layerFb)
+	FreeFramebuffer (_layerFb);
+    if (_layerTex)
+	FreeTexture (_layerTex);
+    _layerFb = _layerTex = 0;
+}
+
+/// Redraws the layers of changed widgets. Returns true if this widget changed.
+bool CWidget::DrawLayers (void)
+{
+    auto changed = Flag (f_Changed);
+    SetFlag (f_Changed, false);
+    if (changed && _layerFb) {
+	SetFlag (f_DrawingLayer);
+	PDraw<bstrs> drws;
+	DrawLayer (drws);
+	auto drww = _prgl->Draw (drws.size(), _layerFb);
+	DrawLayer (drww);
+	SetFlag (f_DrawingLayer, false);
+    }
+    return changed;
+}
+
+//}}}-------------------------------------------------------------------
@@ -18,7 +18,10 @@ public:
     using pfontinfo_t	= PRGL::pfontinfo_t;
     using key_t		= CWindow::key_t;
     enum EFlags {
-	f_Focused
+	f_Focused,
+	f_Layered,	///< Drawn into its own framebuffer and composited as one image
+	f_Changed,	///< Appearance changed since the last DrawLayers
+	f_DrawingLayer
     };
     struct SSize {
 	dim_t w,h;
@@ -26,16 +29,22 @@ public:
 	inline constexpr SSize (dim_t nw, dim_t nh) : w(nw),h(nh) {}
     };
 public:
-    inline		CWidget (PRGL* prgl)		:_prgl(prgl),_x(0),_y(0),_w(0),_h(0),_flags(0) {}
-    virtual inline	~CWidget (void)			{}
+    inline		CWidget (PRGL* prgl)		:_prgl(prgl),_x(0),_y(0),_w(0),_h(0),_flags(1<<f_Changed),_layerTex(0),_layerFb(0) {}
+    virtual inline	~CWidget (void)			{ FreeLayer(); }
     virtual void	OnEvent (const CEvent& e);
-    virtual void	OnResize (dim_t w, dim_t h)	{ _w = w; _h = h; }
+    virtual void	OnResize (dim_t w, dim_t h);
     template <typename Drw>
     inline void		OnDraw (Drw&) const		{}
-    virtual void	OnFocus (bool b) noexcept	{ SetFlag (f_Focused, b); }
-    virtual void	Draw (PDraw<bstrs>& drw) const = 0;
-    virtual void	Draw (PDraw<bstro>& drw) const = 0;
+    virtual void	OnFocus (bool b) noexcept	{ SetFlag (f_Focused, b); Invalidate(); }
+    template <typename Drw>
+    inline void		Draw (Drw& drw) const		{ if (_layerFb) drw.Image (0, 0, _layerTex); else DrawContent (drw); }
+    virtual void	DrawContent (PDraw<bstrs>& drw) const = 0;
+    virtual void	DrawContent (PDraw<bstro>& drw) const = 0;
+    virtual bool	DrawLayers (void);
     virtual SSize	OnMeasure (void) const = 0;
+    void		SetLayered (bool v = true);
+    inline bool		Layered (void) const		{ return Flag (f_Layered); }
+    inline void		Invalidate (void)		{ SetFlag (f_Changed); }
     inline bool		Flag (EFlags f) const		{ return _flags & (1<<f); }
     inline void		SetFlag (EFlags f, bool v=true)	{ if (v) _flags |= (1<<f); else _flags &= ~(1<<f); }
     inline bool		Encloses (coord_t x, coord_t y) const	{ return dim_t(x-_x) < _w && dim_t(y-_y) < _h; };
@@ -64,6 +73,9 @@ public:
     inline goid_t	CreateFramebuffer (std::initializer_list<G::FramebufferComponent> fbc)				{ return _prgl->CreateFramebuffer(fbc); }
     inline goid_t	CreateFramebuffer (goid_t depthbuffer, goid_t colorbuffer)					{ return _prgl->CreateFramebuffer(depthbuffer,colorbuffer); }
     inline void		FreeFramebuffer (goid_t id)			{ _prgl->FreeFramebuffer(id); }
+    inline goid_t	CreateVertexArray (const G::VertexAttrib* pa, unsigned na)					{ return _prgl->CreateVertexArray(pa,na); }
+    inline goid_t	CreateVertexArray (std::initializer_list<G::VertexAttrib> va)					{ return _prgl->CreateVertexArray(va); }
+    inline void		FreeVertexArray (goid_t id)			{ _prgl->FreeVertexArray(id); }
     inline goid_t	LoadFont (const void* d, uint32_t dsz)		{ return _prgl->LoadFont(d,dsz); }
     inline goid_t	LoadFont (const char* f)			{ return _prgl->LoadFont(f); }
     inline goid_t	LoadFont (goid_t pak, const char* f)		{ return _prgl->LoadFont(pak,f); }
@@ -90,6 +102,11 @@ protected:
     inline virtual void	OnMotion (coord_t, coord_t, key_t)	{ }
     inline virtual void	OnCommand (const char*)			{ }
     inline virtual void	OnUIChanged (const char*)		{ }
+private:
+    void		CreateLayer (void);
+    void		FreeLayer (void);
+    template <typename Drw>
+    inline void		DrawLayer (Drw& drw) const		{ drw.Clear (0); DrawContent (drw); }
 private:
     PRGL*		_prgl;
 public:
@@ -97,16 +114,18 @@ public:
     dim_t		_w,_h;
 private:
     uint16_t		_flags;
+    goid_t		_layerTex;
+    goid_t		_layerFb;
 };
 
 //----------------------------------------------------------------------
 
 #define ONWIGDRAWDECL	\
-    virtual void	Draw (PDraw<bstrs>& drw) const override;	\
-    virtual void	Draw (PDraw<bstro>& drw) const override;	\
+    virtual void	DrawContent (PDraw<bstrs>& drw) const override;	\
+    virtual void	DrawContent (PDraw<bstro>& drw) const override;	\
     template <typename Drw> inline void
 
 #define ONWIGDRAWIMPL(W)\
-    void W::Draw (PDraw<bstrs>& drw) const { OnDraw (drw); }	\
-    void W::Draw (PDraw<bstro>& drw) const { OnDraw (drw); }	\
+    void W::DrawContent (PDraw<bstrs>& drw) const { OnDraw (drw); }	\
+    void W::DrawContent (PDraw<bstro>& drw) const { OnDraw (drw); }	\
     template <typename Drw> inline void W
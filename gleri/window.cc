@@ -19,9 +19,11 @@ void CWindow::OnEvent (const CEvent& e)
 	case CEvent::Destroy:		Destroy();			break;
 	case CEvent::Close:		Close();			break;
 	case CEvent::Ping:		Event (e);			break;
-	case CEvent::VSync:		_vsync = e;			break;
+	case CEvent::VSync:		OnVSyncEvent (e);		break;
 	case CEvent::Focus:		OnFocus (e.key);		break;
-	case CEvent::Visibility:	OnVisibility (Visibility(e.key)); break;
+	case CEvent::Visibility:	OnVisibilityEvent (Visibility(e.key)); break;
+	case CEvent::FrameDropped:	_droppedFrames = e.key; AckFrame (e.x); OnFrameDropped(); break;
+	case CEvent::PresentMode:	_presentMode = G::PresentMode (e.key); break;
 	case CEvent::KeyDown:		OnKey (e.key);			break;
 	case CEvent::KeyUp:		OnKeyUp (e.key);		break;
 	case CEvent::ButtonDown:	OnButton (e.key, e.x, e.y);	break;
@@ -43,10 +45,43 @@ void CWindow::OnTimer (uint64_t tms)
     OnVSync();
 }
 
+// Hidden windows are not drawn by the server, so drawing and its timer
+// are stopped until visible again, when the postponed draw is done.
+void CWindow::OnVisibilityEvent (Visibility v)
+{
+    auto wasHidden = _hidden;
+    _hidden = v >= Visibility::FullyObscured;
+    OnVisibility (v);
+    if (wasHidden && !_hidden && _drawPending && _nextVSync == NotWaitingForVSync)
+	Draw();
+}
+
+// The server sends the latest time to submit the next frame, so a waiting
+// redraw is moved there to sample input as late as possible.
+void CWindow::OnVSyncEvent (const CEvent& e)
+{
+    _vsync = e;
+    AckFrame (e.x);
+    if (!_hidden && (_nextVSync != NotWaitingForVSync || _drawPending))
+	WaitForTime (_nextVSync = NowMS() + SubmitDelayMS());
+}
+
 bool CWindow::WaitingForVSync (void)
 {
-    if (_nextVSync != NotWaitingForVSync)
+    if (_nextVSync != NotWaitingForVSync || _hidden)
 	return _drawPending = true;
-    WaitForTime (_nextVSync = NowMS() + RefreshTimeNS()/1000000 + 1);
+    if (FramesInFlight() >= _maxFramesInFlight) {
+	auto now = NowMS();
+	if (!_blockedSince)
+	    _blockedSince = now;
+	if (now < _blockedSince + c_FrameTimeoutMS) {	// Resumed by OnVSyncEvent
+	    WaitForTime (_nextVSync = _blockedSince + c_FrameTimeoutMS);
+	    return _drawPending = true;
+	}
+	AckFrame (_sentSeq);	// Frames that failed to draw are not waited for
+    }
+    // Unthrottled present modes are limited only by the render time
+    auto frameTime = PresentMode() == G::PresentMode::IMMEDIATE || PresentMode() == G::PresentMode::MAILBOX ? LastRenderTimeNS() : RefreshTimeNS();
+    WaitForTime (_nextVSync = NowMS() + frameTime/1000000 + 1);
     return _drawPending = false;
 }
@@ -17,6 +17,7 @@ public:
     using key_t		= uint32_t;
     using rcwininfo_t	= const WinInfo&;
     enum { NotWaitingForVSync = UINT64_MAX };
+    enum { c_MaxFramesInFlight = 3 };
 public:
     inline explicit	CWindow (iid_t wid) noexcept;
     inline virtual	~CWindow (void)			{ }
@@ -28,6 +29,7 @@ public:
     inline virtual void	OnVSync (void)			{ if (_drawPending) Draw(); }
     inline void		OnRestate (rcwininfo_t wi)	{ _info = wi; OnResize (wi.w, wi.h); }
     inline virtual void	OnResize (dim_t, dim_t)		{ }
+    inline virtual void	OnDrawLayers (void)		{ }	///< Offscreen layers are drawn here, before the frame
     virtual void	OnError (const char* m)		{ XError::emit (m); }
     virtual void	OnEvent (const CEvent& e);
     inline void		OnSaveFramebufferData (goid_t id, const char* filename, const SDataBlock& d);
@@ -49,8 +51,16 @@ protected:
     inline rcwininfo_t	Info (void) const		{ return _info; }
     inline uint32_t	LastRenderTimeNS (void) const	{ return _vsync.time; }
     inline uint32_t	RefreshTimeNS (void) const	{ return _vsync.key; }
+    inline G::PresentMode PresentMode (void) const	{ return _presentMode; }
+    inline uint32_t	DroppedFrames (void) const	{ return _droppedFrames; }
+    inline unsigned	SubmitDelayMS (void) const	{ return uint16_t(_vsync.y); }
+    inline bool		Visible (void) const		{ return !_hidden; }
+    inline unsigned	FramesInFlight (void) const	{ return uint16_t(_sentSeq-_ackedSeq) - (_sentSeq < _ackedSeq); }	// Sequence numbers skip 0
+			/// Throughput-bound windows may build up to 3 frames ahead; the default of 1 has the lowest latency
+    inline void		SetMaxFramesInFlight (unsigned n)	{ _maxFramesInFlight = min (max (n, 1u), unsigned(c_MaxFramesInFlight)); }
     inline virtual void	OnFocus (bool)			{ }
     inline virtual void	OnVisibility (Visibility)	{ }
+    inline virtual void	OnFrameDropped (void)		{ }
     inline virtual void	OnKey (key_t)				{ }
     inline virtual void	OnKeyUp (key_t)				{ }
     inline virtual void	OnButton (key_t, coord_t, coord_t)	{ }
@@ -67,14 +77,28 @@ protected:
     inline void		OnDraw (Drw&) const		{ }
     inline void		WaitForTime (uint64_t tms)const;// Body in glapp.h (because CApp needed)
     bool		WaitingForVSync (void);
+    void		OnVSyncEvent (const CEvent& e);
     inline uint64_t	NowMS (void) const noexcept;
+private:
+    enum { c_FrameTimeoutMS = 500 };	///< Frames that fail to draw are never acknowledged
+private:
+    inline void		SentFrame (void)		{ if (!++_sentSeq) ++_sentSeq; }
+    inline void		AckFrame (uint16_t seq)		{ if (seq) { _ackedSeq = seq; _blockedSince = 0; } }
+    void		OnVisibilityEvent (Visibility v);
 private:
     WinInfo		_info;
     CEvent		_vsync;
     uint64_t		_nextVSync;
+    uint64_t		_blockedSince;	///< When drawing was first blocked by too many frames in flight
+    uint32_t		_droppedFrames;	///< Replaced by a newer frame before being drawn
+    uint16_t		_sentSeq;	///< Sequence number of the last frame sent
+    uint16_t		_ackedSeq;	///< Sequence number of the last frame the server is done with
+    uint8_t		_maxFramesInFlight;
+    G::PresentMode	_presentMode;	///< As set by the server, which may fall back from the requested one
     bool		_drawPending;
     bool		_closePending;
     bool		_destroyPending;
+    bool		_hidden;	///< Fully obscured or unmapped; drawing waits until visible
 };
 
 //----------------------------------------------------------------------
@@ -84,9 +108,16 @@ CWindow::CWindow (iid_t wid) noexcept
 ,_info()
 ,_vsync()
 ,_nextVSync (NotWaitingForVSync)
+,_blockedSince (0)
+,_droppedFrames (0)
+,_sentSeq (0)
+,_ackedSeq (0)
+,_maxFramesInFlight (1)
+,_presentMode (G::PresentMode::VSYNC)
 ,_drawPending (false)
 ,_closePending (false)
 ,_destroyPending (false)
+,_hidden (false)
 {
     _vsync.key = 1000000000/60;
 }
@@ -96,10 +127,12 @@ void CWindow::DrawT (const W& w)
 {
     if (WaitingForVSync())
 	return;
+    OnDrawLayers();
     PDraw<bstrs> drws;
     w.OnDraw (drws);
     auto drww = PRGL::Draw (drws.size());
     w.OnDraw (drww);
+    SentFrame();
 }
 
 void CWindow::OnSaveFramebufferData (goid_t id, const char* filename, const SDataBlock& d)
@@ -23,14 +23,28 @@ CGleris::CGleris (void) noexcept
 : CApp()
 ,_curCli (nullptr)
 ,_win()
+,_winByIId()
+,_winByXid()
 ,_iconn()
+,_iothread()
+,_renderResults()
+,_workers()
+,_curInput (nullptr)
 ,_dpy (nullptr)
 ,_rootWindow (None)
 ,_nextiid (0)
+,_ctxSwitches (0)
+,_ctxSwitchesSkipped (0)
+,_ctxSwitchRate (0)
+,_ctxSwitchTime (0)
+,_frameClock (NoTimer)
+,_swapQueue()
 ,_localSocket()
 ,_tcpSocket()
 ,_glversion (0)
 ,_options (0)
+,_glxexts (0)
+,_glxEventBase (0)
 ,_atoms()
 ,_dinfo()
 ,_fbconfig()
@@ -55,9 +69,13 @@ CGleris::~CGleris (void) noexcept
 	_localSocket.ForceClose();
 	unlink (s_SocketPath);
     }
+    if (_iothread)
+	_iothread->Stop();
     for (auto w = _win.end(); w-- > _win.begin();)
 	DestroyClient (*w);
     _win.clear();
+    _winByIId.clear();
+    _winByXid.clear();
     for (auto& c : _iconn)
 	delete c;
     _iconn.clear();
@@ -71,10 +89,12 @@ CGleris::~CGleris (void) noexcept
 void CGleris::OnArgs (argc_t argc, argv_t argv) noexcept
 {
     for (;;) {
-	switch (getopt(argc, argv, "?std")) {
+	switch (getopt(argc, argv, "?stidr")) {
 	    case -1:	return;
 	    case 's':	SetOption (opt_SingleClient); break;
 	    case 't':	SetOption (opt_TCPSocket); break;
+	    case 'i':	SetOption (opt_IOThread); break;
+	    case 'r':	SetOption (opt_RenderThreads); break;
 	#ifndef NDEBUG
 	    case 'd':	{ extern bool g_bDebugTrace; g_bDebugTrace = true; } break;
 	#endif
@@ -84,13 +104,15 @@ void CGleris::OnArgs (argc_t argc, argv_t argv) noexcept
 		    "An OpenGL interface service\n\n"
 		    "Usage:\t" GLERIS_NAME
 		#ifndef NDEBUG
-		    " [-dst]\n\n"
+		    " [-dstir]\n\n"
 		    "\t-d\toutput debugging information to stdout\n"
 		#else
-		    " [-st]\n\n"
+		    " [-stir]\n\n"
 		#endif
 		    "\t-s\tsingle client mode, command socket on stdin\n"
 		    "\t-t\tcreate tcp socket on localhost:" PP_STRINGIFY_I(GLERIS_PORT) "+display\n"
+		    "\t-i\tread client connections on a separate thread\n"
+		    "\t-r\tdraw each window on a separate thread\n"
 		);
 		exit (EXIT_SUCCESS);
 	}
@@ -100,27 +122,39 @@ void CGleris::OnArgs (argc_t argc, argv_t argv) noexcept
 //}}}-------------------------------------------------------------------
 //{{{ Connection managment
 
-void CGleris::AddConnection (int fd, bool canPassFd)
+static inline bool ConnFdLess (const CIConn* c, int fd)
+    { return c->Fd() < fd; }
+
+CIConn* CGleris::AddConnection (int fd, bool canPassFd)
 {
     DTRACE("Incoming connection on %d, %s pass fds\n", fd, canPassFd ? "can" : "can't");
-    _iconn.push_back (new CIConn (GenIId(), fd, canPassFd));
-    if (fd >= 0)
+    auto pconn = new CIConn (GenIId(), fd, canPassFd);
+    _iconn.insert (lower_bound (_iconn.begin(), _iconn.end(), fd, ConnFdLess), pconn);
+    if (fd < 0)
+	return pconn;
+    if (_iothread)
+	_iothread->Watch (fd, canPassFd);
+    else
 	WatchFd (fd);
+    return pconn;
 }
 
 void CGleris::RemoveConnection (int fd) noexcept
 {
     DTRACE("Removing connection on %d\n", fd);
-    for (auto i = _iconn.begin(); i < _iconn.end(); ++i) {
-	if ((*i)->Fd() != fd) continue;
-	for (auto j = _win.begin(); j < _win.end(); ++j) {
-	    if ((*j)->Matches(fd)) {
-		DestroyClient (*j);
-		--(j = _win.erase(j));
-	    }
+    auto i = lower_bound (_iconn.begin(), _iconn.end(), fd, ConnFdLess);
+    if (i < _iconn.end() && (*i)->Fd() == fd) {
+	// The connection's windows are contiguous in _winByIId
+	auto wfirst = lower_bound (_winByIId.begin(), _winByIId.end(), ClientKey(fd,0), ClientKeyLess);
+	auto wlast = lower_bound (wfirst, _winByIId.end(), ClientKey(fd,UINT16_MAX)+1, ClientKeyLess);
+	vector<CGLWindow*> dw (wfirst, wlast);
+	for (auto w : dw) {
+	    auto j = find (_win.begin(), _win.end(), w);
+	    DestroyClient (*j);
+	    _win.erase (j);
 	}
 	delete (*i);
-	--(i = _iconn.erase(i));
+	_iconn.erase(i);
     }
     if (_iconn.size() <= 1 && (Option (opt_SingleClient) || Option (opt_SystemdActivated))) {
 	DTRACE("Last connection terminated in single-client mode; quitting\n");
@@ -130,10 +164,41 @@ void CGleris::RemoveConnection (int fd) noexcept
 
 CCmdBuf* CGleris::LookupConnection (int fd) noexcept
 {
-    for (auto i = _iconn.begin(); i < _iconn.end(); ++i)
-	if ((*i)->Fd() == fd)
-	    return *i;
-    return nullptr;
+    auto i = lower_bound (_iconn.begin(), _iconn.end(), fd, ConnFdLess);
+    return (i < _iconn.end() && (*i)->Fd() == fd) ? *i : nullptr;
+}
+
+void CGleris::ProcessInput (void)
+{
+    for (CIOThread::SInput i; _iothread->PopInput (i);) {
+	if (!i.data)	// The connection fd is closed by the CIConn destructor
+	    RemoveConnection (i.fd);
+	else {
+	    auto pic = LookupConnection (i.fd);
+	    _curInput = CRecvBuf::Adopt (i.data);	// Pending frames may keep references to it
+	    if (pic) {
+		bstri is (i.data, i.sz);
+		pic->ProcessMessages<PRGL> (*this, is);
+	    }
+	    _curInput->Unref();
+	    _curInput = nullptr;
+	}
+    }
+}
+
+void CGleris::ProcessRenderResults (void)
+{
+    CRenderResults::resultvec_t rv;
+    _renderResults->Take (rv);
+    for (auto& r : rv) {
+	auto pcli = ClientRecord (r.fd, r.iid);
+	if (!pcli)	// Closed since
+	    continue;
+	if (r.error.empty())
+	    pcli->Event (r.e);
+	else
+	    ForwardError ("Draw", XError ("%s", r.error.c_str()), r.fd, r.iid);
+    }
 }
 
 void CGleris::Authenticate (CCmdBuf& cmdbuf, uint32_t pid, uint32_t screen, const char* hostname, const SDataBlock& argv, const SDataBlock& xauth)
@@ -222,10 +287,22 @@ void CGleris::Init (argc_t argc, argv_t argv)
     //
     // Connect to X display and get server information
     //
+    if (Option (opt_RenderThreads) && !XInitThreads())
+	XError::emit ("Xlib does not support threads");
     _dpy = XOpenDisplay (nullptr);
     if (!_dpy)
 	XError::emit ("could not open X display");
     WatchFd (ConnectionNumber(_dpy));
+    if (Option (opt_IOThread)) {
+	_iothread.reset (new CIOThread);
+	_iothread->Start();
+	WatchFd (_iothread->InputFd());
+    }
+    if (Option (opt_RenderThreads)) {
+	_renderResults.reset (new CRenderResults);
+	WatchFd (_renderResults->Fd());
+	WorkerPool();	// Created here because render threads post readbacks to it
+    }
 
     GetAtoms();
 
@@ -233,6 +310,25 @@ void CGleris::Init (argc_t argc, argv_t argv)
     if (!glXQueryVersion (_dpy, &glx_major, &glx_minor) || (glx_major<<4|glx_minor) < 0x14)
 	XError::emit ("X server does not support GLX 1.4");
     DTRACE("Opened X server connection. GLX %d.%d available\n", glx_major, glx_minor);
+
+    // Swap control and completion extensions, in EGLXExt order
+    static const char* const c_GLXExtNames[] = {
+	"GLX_OML_sync_control",
+	"GLX_INTEL_swap_event",
+	"GLX_EXT_swap_control",
+	"GLX_EXT_swap_control_tear",
+	"GLX_MESA_swap_control",
+	"GLX_EXT_buffer_age",
+	"GLX_MESA_copy_sub_buffer"
+    };
+    auto glxexts = glXQueryExtensionsString (_dpy, _dinfo.screen);
+    for (auto i = 0u; glxexts && i < ArraySize(c_GLXExtNames); ++i)
+	if (strstr (glxexts, c_GLXExtNames[i]))
+	    _glxexts |= 1<<i;
+    auto glxErrorBase = 0;	// Swap events are only useful with the swap counter from OML
+    if (!HaveGLXExt (glxext_OMLSyncControl) || !glXQueryExtension (_dpy, &glxErrorBase, &_glxEventBase))
+	_glxexts &= ~(1<<glxext_IntelSwapEvent);
+    DTRACE("GLX extensions used: %x\n", _glxexts);
     //
     // Get fbconfigs and visuals
     //
@@ -302,13 +398,13 @@ void CGleris::Init (argc_t argc, argv_t argv)
     glXDestroyContext (_dpy, ctx);
     XDestroyWindow (_dpy, rctxw);
 
-    AddConnection (-1, false);			// Dummy connection object for the share root window
+    auto rconn = AddConnection (-1, false);	// Dummy connection object for the share root window
     auto mypid = getpid();
     char hostname [HOST_NAME_MAX];
     gethostname (ArrayBlock(hostname));
-    Authenticate (*_iconn.back(), mypid, 0, hostname, CCmd::SDataBlock(argv[0],strlen(argv[0])), CCmd::SDataBlock(_xauth,sizeof(_xauth)));
-    CreateClient (0, rootinfo, "gleris", _iconn.back());
-    _iconn.back()->LoadDefaultResources (_curCli);
+    Authenticate (*rconn, mypid, 0, hostname, CCmd::SDataBlock(argv[0],strlen(argv[0])), CCmd::SDataBlock(_xauth,sizeof(_xauth)));
+    CreateClient (0, rootinfo, "gleris", rconn);
+    rconn->LoadDefaultResources (_curCli);
 
     // Set WM properties on the root context's window
     Xutf8SetWMProperties (_dpy, _curCli->Drawable(), GLERIS_NAME, nullptr, const_cast<char**>(argv), argc, nullptr, nullptr, nullptr);
@@ -518,14 +614,21 @@ void CGleris::OnXEvent (void)
 	    continue;
 	}
 
-	if (xev.type == Expose)
-	    icli->Draw();
-	else if (xev.type == ConfigureNotify) {
+	if (xev.type == Expose) {
+	    if (!icli->CanRedraw())	// Resized or resources changed since the last frame
+		icli->Draw();
+	    else if (icli->HasRenderThread())
+		icli->RenderThread().Redraw();
+	    else {	// Redrawn without waiting for the client
+		icli->RequestRedraw();
+		ScheduleFrame (NowMS());
+	    }
+	} else if (xev.type == ConfigureNotify) {
 	    try {
-		ActivateClient (*icli);
+		PauseRenderThreads (icli->Fd());
 		icli->Resize (xev.xconfigure.x, xev.xconfigure.y, xev.xconfigure.width, xev.xconfigure.height);
 	    } catch (XError& e) {
-		DTRACE ("[%x] GL error while resizing: %s\n", e.what());
+		DTRACE ("[%x] Error while resizing: %s\n", icli->IId(), e.what());
 	    }
 	} else if (xev.type == KeyPress || xev.type == KeyRelease) {
 	    DTRACE ("[%x] Receive keypress %u\n", icli->IId(), xev.xkey.keycode);
@@ -546,7 +649,12 @@ void CGleris::OnXEvent (void)
 	    icli->Event (CEvent (CEvent::Crossing, ModsFromXState(xev.xcrossing.state), xev.xcrossing.x, xev.xcrossing.y, bEnter));
 	} else if (xev.type == VisibilityNotify) {
 	    DTRACE ("[%x] Visibility change to %d\n", icli->IId(), xev.xvisibility.state);
+	    icli->SetHidden (xev.xvisibility.state == VisibilityFullyObscured);
 	    icli->Event (CEvent (CEvent::Visibility, xev.xvisibility.state));
+	} else if (xev.type == UnmapNotify) {	// Also on minimizing
+	    DTRACE ("[%x] Receive unmap notification\n", icli->IId());
+	    icli->SetHidden (true);
+	    icli->Event (CEvent (CEvent::Visibility, uint32_t(Visibility::Hidden)));
 	} else if (xev.type == MapNotify) {
 	    DTRACE ("[%x] Receive map notification\n", icli->IId());
 	    if (icli->Info().IsPopupMenu()) {	// override-redirect windows do not automatically get focus
@@ -561,6 +669,8 @@ void CGleris::OnXEvent (void)
 	    }
 	} else if (xev.type == DestroyNotify) {
 	    DTRACE ("[%x] Receive destroy notification\n", icli->IId());
+	    UnindexClient (icli);
+	    icli->StopRenderThread();
 	    icli->SetDrawable (None);
 	    icli->Event (CEvent (CEvent::Destroy));
 	    try { icli->WriteCmds(); } catch (...) {};	// If this fails, the client is already disconnected
@@ -582,6 +692,11 @@ void CGleris::OnXEvent (void)
 		DTRACE ("[%x] Unknown WM_PROTOCOLS message %s\n", icli->IId(), XGetAtomName(_dpy, xev.xclient.data.l[0]));
 	    #endif
 	    }
+	} else if (HaveGLXExt (glxext_IntelSwapEvent) && xev.type == _glxEventBase+GLX_BufferSwapComplete) {
+	    auto& sce = reinterpret_cast<const GLXBufferSwapComplete&>(xev);
+	    DTRACE ("[%x] Swap %ld complete at %lu\n", icli->IId(), sce.sbc, sce.ust);
+	    if (!icli->HasRenderThread())	// Render threads poll for completion themselves
+		ScheduleFrame (icli->SwapComplete (sce.ust, sce.sbc));
 	} else if (xev.type == SelectionRequest) {
 	    DTRACE ("[%x] Receive selection request\n", icli->IId());
 	    ProcessSelectionRequest (*icli, xev.xselectionrequest);
@@ -596,6 +711,7 @@ void CGleris::OnXEvent (void)
     }
     for (auto c : _win)
 	try { c->WriteCmds(); } catch (...) {}	// fd errors will be caught by poll
+    ResumeRenderThreads();
     if (_xlib_error) {
 	DTRACE ("Xlib error: %s\n", _xlib_error);
 	syslog (LOG_ERR, "Xlib error: %s", _xlib_error);
@@ -777,11 +893,27 @@ void CGleris::OnFd (int fd)
 	if (cfd < 0)
 	    XError::emit ("accept");
 	AddConnection (cfd, fd == _localSocket.Fd());
-    } else {
+    } else if (_iothread && fd == _iothread->InputFd())
+	ProcessInput();
+    else if (_renderResults && fd == _renderResults->Fd())
+	ProcessRenderResults();
+    else if (_workers && fd == _workers->Fd())
+	_workers->FinishJobs();
+    else {
 	auto pic = LookupConnection(fd);
 	if (pic) {
 	    pic->ReadCmds();
-	    pic->ProcessMessages<PRGL> (*this);
+	    auto is = pic->BeginRead();
+	    _curInput = CRecvBuf::Adopt (const_cast<uint8_t*>(is.ipos()));	// As in ProcessInput
+	    pic->ProcessMessages<PRGL> (*this, is);
+	    if (_curInput->Unique()) {
+		_curInput->Disown();	// Still the connection's read buffer
+		pic->EndRead (is);
+	    } else {			// Pending frames keep it; reading continues in a new one
+		pic->DetachRead (is);
+		_curInput->Unref();
+	    }
+	    _curInput = nullptr;
 	}
     }
     OnXEvent();
@@ -800,21 +932,61 @@ void CGleris::OnFdError (int fd)
 void CGleris::OnTimer (uint64_t tms)
 {
     CApp::OnTimer (tms);
+    UpdateContextSwitchRate (tms);
+    if (tms == _frameClock)
+	RunFrameClock (tms);
     for (auto c : _win) {
-	if (c->NextFrameTime() == tms) {
-	    try {
-		DTRACE ("[%x] Rendering queued frame after vsync\n", c->IId());
-		ActivateClient (*c);
-		WaitForTime (c->DrawPendingFrame (_dpy));
-	    } catch (XError& e) {
-		DTRACE ("[%x] Queued frame generated error: %s\n", c->IId(), e.what());
-		ForwardError ("Draw", e, c->Fd(), c->IId());
-	    }
-	    c->ClearPendingFrame();
+	if (c->HasRenderThread() || !c->ReadbacksPending())
+	    continue;
+	try {
+	    ActivateClient (*c);
+	    c->FinishReadbacks();
+	} catch (XError& e) {
+	    ForwardError ("SaveFramebuffer", e, c->Fd(), c->IId());
 	}
+	if (c->ReadbacksPending())
+	    WaitForTime (NowMS() + CGLWindow::c_ReadbackPollMS);
     }
     OnXEvent();
 }
+
+/// One frame clock drives all windows drawn on the main thread. Each tick
+/// renders every window with a frame ready, and then swaps them together,
+/// so that no window's swap waits on vsync while others are still drawing.
+void CGleris::RunFrameClock (uint64_t tms)
+{
+    _frameClock = NoTimer;
+    _swapQueue.clear();
+    // Large textures are uploaded a slice per tick, before drawing with them
+    auto uploading = false;
+    for (auto pic : _iconn)
+	uploading |= pic->UploadSlices();
+    for (auto c : _win) {
+	if (c->HasRenderThread() || !c->FrameDue (tms))
+	    continue;
+	try {
+	    ActivateClient (*c);
+	    if (c->RenderPendingFrame (_dpy))
+		_swapQueue.push_back (c);
+	} catch (XError& e) {
+	    DTRACE ("[%x] Queued frame generated error: %s\n", c->IId(), e.what());
+	    ForwardError ("Draw", e, c->Fd(), c->IId());
+	    c->ClearPendingFrame();
+	}
+    }
+    // In reverse, because the last window rendered is still current
+    for (auto c = _swapQueue.end(); c-- > _swapQueue.begin();) {
+	ActivateClient (**c);
+	(*c)->SwapFrame (_dpy);
+    }
+    DTRACE ("Frame clock tick at %lu swapped %zu windows\n", tms, _swapQueue.size());
+    // The next tick is when the first window's frame is expected to be done
+    for (auto c : _win)
+	if (!c->HasRenderThread())
+	    ScheduleFrame (c->NextFrameTime());
+    if (uploading)
+	ScheduleFrame (tms + CTextureLoad::c_SliceIntervalMS);
+}
 //}}}2
 //}}}-------------------------------------------------------------------
 //{{{ Client records, selection and forwarding
@@ -836,9 +1008,9 @@ CGLWindow* CGleris::CreateClient (iid_t iid, WinInfo winfo, const char* title, C
 
     // Find the parent window
     auto parentWid = _rootWindow;
-    for (const auto w : _win)
-	if (w->Matches (piconn->Fd(), winfo.parent))
-	    parentWid = w->Drawable();
+    auto pw = ClientRecord (piconn->Fd(), winfo.parent);
+    if (pw)
+	parentWid = pw->Drawable();
 
     // Get display information
     winfo.scrw = DisplayWidth (_dpy, _dinfo.screen);
@@ -877,9 +1049,15 @@ CGLWindow* CGleris::CreateClient (iid_t iid, WinInfo winfo, const char* title, C
     auto& rcli = *_win.back();
     if (piconn)
 	rcli.SetFd (piconn->Fd(), piconn->CanPassFd());
+    IndexClient (&rcli);
     ActivateClient (rcli);
-    if (_win.size() > 1)	// The root client has no state
-	rcli.Init();
+    if (_win.size() > 1) {	// The root client has no state
+	rcli.Init (_dpy);
+	if (HaveGLXExt (glxext_IntelSwapEvent))
+	    glXSelectEvent (_dpy, wid, GLX_BUFFER_SWAP_COMPLETE_INTEL_MASK);
+	if (_renderResults)	// Started paused; resumed with the context released by the main thread
+	    rcli.StartRenderThread (_dpy, *_renderResults);
+    }
 
     // Set additional window attributes and map if not hidden
     if (winfo.IsParented()) {
@@ -968,6 +1146,8 @@ Window CGleris::CreateWindow (const WinInfo& winfo, Window parentWid)
 
 void CGleris::ActivateClient (CGLWindow& rcli) noexcept
 {
+    if (rcli.HasRenderThread())	// Resources shared by the connection's windows are about to change
+	PauseRenderThreads (rcli.Fd());
     if (_curCli == &rcli)
 	return;
     if (_curCli) {
@@ -975,10 +1155,72 @@ void CGleris::ActivateClient (CGLWindow& rcli) noexcept
 	_curCli->Deactivate();
 	_curCli = nullptr;
     }
+    if (rcli.HasRenderThread())
+	rcli.RenderThread().AcquireContext();
     DTRACE ("Activate client window %x, context %x\n", rcli.Drawable(), rcli.ContextId());
     glXMakeCurrent (_dpy, rcli.Drawable(), rcli.ContextId());
     _curCli = &rcli;
     rcli.Activate();
+    ++_ctxSwitches;
+    UpdateContextSwitchRate (NowMS());
+}
+
+/// Objects other than framebuffers and vertex arrays are shared by all
+/// contexts, so they can be loaded in whichever one is current. Render
+/// thread contexts are excluded because the render thread may own them.
+void CGleris::ActivateForSharedObjects (CGLWindow& rcli) noexcept
+{
+    if (!_curCli || _curCli == &rcli || _curCli->HasRenderThread() || rcli.HasRenderThread())
+	return ActivateClient (rcli);
+    ++_ctxSwitchesSkipped;
+}
+
+void CGleris::UpdateContextSwitchRate (uint64_t now) noexcept
+{
+    if (now < _ctxSwitchTime+1000)
+	return;
+    auto rate = now < _ctxSwitchTime+2000 ? _ctxSwitches : 0;
+    if (rate != _ctxSwitchRate || _ctxSwitchesSkipped)
+	DTRACE ("Context switches: %u/s, %u avoided\n", rate, _ctxSwitchesSkipped);
+    _ctxSwitchRate = rate;
+    _ctxSwitches = 0;
+    _ctxSwitchesSkipped = 0;
+    _ctxSwitchTime = now;
+}
+
+void CGleris::PauseRenderThreads (int fd) noexcept
+{
+    auto wfirst = lower_bound (_winByIId.begin(), _winByIId.end(), ClientKey(fd,0), ClientKeyLess);
+    for (auto w = wfirst; w < _winByIId.end() && (*w)->Fd() == fd; ++w)
+	if ((*w)->HasRenderThread())
+	    (*w)->RenderThread().Pause();
+}
+
+void CGleris::ResumeRenderThreads (void) noexcept
+{
+    if (!_renderResults)
+	return;
+    auto npaused = 0u;
+    for (auto w : _win)
+	npaused += w->HasRenderThread() && w->RenderThread().Paused();
+    if (!npaused)
+	return;
+    if (_curCli) {
+	// Render threads wait for changes made in the current context before drawing
+	for (auto w : _win)
+	    if (w != _curCli && w->HasRenderThread() && w->RenderThread().Paused())
+		w->RenderThread().SetFence (glFenceSync (GL_SYNC_GPU_COMMANDS_COMPLETE, 0));
+	glFlush();
+	if (_curCli->HasRenderThread()) {	// Give the context back to its thread
+	    DTRACE ("Release client window %x, context %x\n", _curCli->Drawable(), _curCli->ContextId());
+	    _curCli->Deactivate();
+	    glXMakeCurrent (_dpy, None, nullptr);
+	    _curCli = nullptr;
+	}
+    }
+    for (auto w : _win)
+	if (w->HasRenderThread())
+	    w->RenderThread().Resume();
 }
 
 void CGleris::ResizeClient (CGLWindow& rcli, WinInfo winfo, const char* title)
@@ -1032,6 +1274,8 @@ void CGleris::CloseClient (CGLWindow* pcli) noexcept
 
 void CGleris::DestroyClient (CGLWindow*& pc) noexcept
 {
+    pc->StopRenderThread();
+    UnindexClient (pc);
     if (_dpy) {
 	DTRACE ("Erasing client with window %x, context %x\n", pc->Drawable(), pc->ContextId());
 	_curCli = nullptr;		// Whenever any window dies, ALL GL contexts become detached
@@ -1044,6 +1288,7 @@ void CGleris::DestroyClient (CGLWindow*& pc) noexcept
 	ActivateClient (*_win[0]);
 	pc->FreeResources();
 	glXMakeCurrent (_dpy, None, nullptr);
+	_curCli = nullptr;
 	glXDestroyContext (_dpy, pc->ContextId());
 	CloseClient (pc);
     }
@@ -1051,31 +1296,68 @@ void CGleris::DestroyClient (CGLWindow*& pc) noexcept
     pc = nullptr;
 }
 
+void CGleris::IndexClient (CGLWindow* pcli)
+{
+    _winByIId.insert (lower_bound (_winByIId.begin(), _winByIId.end(), ClientKey(pcli), ClientKeyLess), pcli);
+    _winByXid.insert (lower_bound (_winByXid.begin(), _winByXid.end(), pcli->Drawable(), ClientXidLess), pcli);
+}
+
+void CGleris::UnindexClient (CGLWindow* pcli) noexcept
+{
+    auto i = lower_bound (_winByIId.begin(), _winByIId.end(), ClientKey(pcli), ClientKeyLess);
+    if (i < _winByIId.end() && *i == pcli)
+	_winByIId.erase (i);
+    auto x = lower_bound (_winByXid.begin(), _winByXid.end(), pcli->Drawable(), ClientXidLess);
+    if (x < _winByXid.end() && *x == pcli)	// Already unindexed if DestroyNotify was received
+	_winByXid.erase (x);
+}
+
 CGLWindow* CGleris::ClientRecord (int fd, iid_t iid) noexcept
 {
-    for (auto& icli : _win) {
-	if (icli->Matches (fd,iid)) {
-	    ActivateClient (*icli);
-	    return icli;
-	}
-    }
-    return nullptr;
+    auto k = ClientKey (fd, iid);
+    auto i = lower_bound (_winByIId.begin(), _winByIId.end(), k, ClientKeyLess);
+    return (i < _winByIId.end() && ClientKey(*i) == k) ? *i : nullptr;
 }
 
 CGLWindow* CGleris::ClientRecordForWindow (Window w) noexcept
 {
-    for (auto& icli : _win)
-	if (icli->Drawable() == w)
-	    return icli;
-    return nullptr;
+    auto i = lower_bound (_winByXid.begin(), _winByXid.end(), w, ClientXidLess);
+    return (i < _winByXid.end() && (*i)->Drawable() == w) ? *i : nullptr;
 }
 
 void CGleris::ClientDraw (CGLWindow& cli, G::goid_t fbid, bstri cmdis)
 {
-    if (fbid != G::default_Framebuffer)
+    if (cli.MustWaitForLoads()) {
+	do {
+	    _workers->WaitForJob();
+	    _workers->FinishJobs();	// Activates the context of each loaded texture
+	} while (cli.MustWaitForLoads());
+    }
+    if (cli.HasRenderThread()) {
+	cli.RenderThread().Post (fbid, cmdis, _curInput, fbid == G::default_Framebuffer ? cli.ReceiveFrame() : 0);
+	ResumeRenderThreads();
+	return;
+    } else if (fbid != G::default_Framebuffer) {
+	ActivateClient (cli);
 	cli.ParseDrawlist (fbid, cmdis);
-    else
-	WaitForTime (cli.DrawFrameNoWait (cmdis, _dpy));
+	cli.CheckForErrors();
+    } else {	// Drawn on the next frame clock tick, with other windows
+	cli.SetPendingFrame (cmdis, _curInput, cli.ReceiveFrame());
+	auto now = NowMS();
+	if (cli.FrameDue (now))
+	    ScheduleFrame (now);
+    }
+    if (cli.ReadbacksPending())	// Polled in OnTimer
+	WaitForTime (NowMS() + CGLWindow::c_ReadbackPollMS);
+}
+
+CWorkerPool& CGleris::WorkerPool (void)
+{
+    if (!_workers) {
+	_workers.reset (new CWorkerPool);
+	WatchFd (_workers->Fd());
+    }
+    return *_workers;
 }
 
 void CGleris::ClientEvent (const CGLWindow& cli, const CEvent& e)
@@ -1094,6 +1376,24 @@ void CGleris::ClientEvent (const CGLWindow& cli, const CEvent& e)
     }
 }
 
+void CGleris::ClientCapture (CGLWindow& cli, G::CaptureFmt fmt, uint16_t interval, const char* filename)
+{
+    if (!filename || !*filename) {
+	ActivateClient (cli);	// Pending capture readbacks are finished in its context
+	cli.StopCapture();
+    } else {
+	if (cli.HasRenderThread())
+	    cli.RenderThread().Pause();	// Resumed in OnXEvent
+	cli.StartCapture (filename, fmt, interval);
+    }
+}
+
+void CGleris::ClientPresentMode (CGLWindow& cli, G::PresentMode m)
+{
+    ActivateClient (cli);	// Also pauses the render thread
+    cli.SetPresentMode (_dpy, m);
+}
+
 void CGleris::ClientGetClipboard (CGLWindow& cli, G::Clipboard eci, G::ClipboardFmt fmt)
 {
     const char* d = nullptr;
@@ -6,6 +6,7 @@
 #pragma once
 #include "gleri.h"
 #include "gwin.h"
+#include "iothread.h"
 
 //----------------------------------------------------------------------
 
@@ -16,13 +17,25 @@ public:
 	opt_SingleClient,
 	opt_SystemdActivated,
 	opt_TCPSocket,
+	opt_IOThread,
+	opt_RenderThreads,
 	opt_Last
     };
+    enum EGLXExt {
+	glxext_OMLSyncControl,
+	glxext_IntelSwapEvent,
+	glxext_EXTSwapControl,
+	glxext_EXTSwapControlTear,
+	glxext_MESASwapControl,
+	glxext_EXTBufferAge,
+	glxext_MESACopySubBuffer
+    };
 public:
     static CGleris&	Instance (void) noexcept	{ static CGleris app; return app; }
     virtual		~CGleris (void) noexcept;
     void		Init (argc_t argc, argv_t argv);
     inline bool		Option (EOption o) const	{ return _options & (1<<o); }
+    inline bool		HaveGLXExt (EGLXExt e) const	{ return _glxexts & (1<<e); }
 private:
     enum { c_SocketPathLen = sizeof(sockaddr_un::sun_path) };
     using iid_t		= CGLWindow::iid_t;
@@ -115,6 +128,11 @@ public:
 			// Client id translation
     CGLWindow*		ClientRecord (int fd, iid_t iid) noexcept;
     CGLWindow*		ClientRecordForWindow (Window w) noexcept;
+    void		ActivateClient (CGLWindow& rcli) noexcept;
+    void		ActivateForSharedObjects (CGLWindow& rcli) noexcept;
+    inline void		ScheduleUploads (void)		{ ScheduleFrame (NowMS()); }
+    CWorkerPool&	WorkerPool (void);
+    void		ForwardError (const char* cmdname, const XError& e, int fd, iid_t iid) noexcept;
     void		Authenticate (CCmdBuf& cmdbuf, uint32_t pid, uint32_t screen, const char* hostname, const SDataBlock& argv, const SDataBlock& xauth);
     CGLWindow*		CreateClient (iid_t iid, WinInfo winfo, const char* title, CCmdBuf* piconn);
     void		ResizeClient (CGLWindow& pcli, WinInfo winfo, const char* title);
@@ -123,6 +141,8 @@ public:
     void		ClientEvent (const CGLWindow& cli, const CEvent& e);
     void		SetClientCursor (const CGLWindow& cli, G::Cursor c)	{ XDefineCursor (_dpy, cli.Drawable(), LoadCursor(c)); }
     void		ClientGetClipboard (CGLWindow& cli, G::Clipboard ci, G::ClipboardFmt fmt);
+    void		ClientCapture (CGLWindow& cli, G::CaptureFmt fmt, uint16_t interval, const char* filename);
+    void		ClientPresentMode (CGLWindow& cli, G::PresentMode m);
     void		ClientSetClipboard (CGLWindow& cli, G::Clipboard ci, G::ClipboardFmt fmt, const char* data);
     void		ForwardError (const CCmd::SMsgHeader& h, const XError& e, int fd) noexcept;
     void		OnExport (const char*, int fd);
@@ -130,12 +150,23 @@ public:
 private:
     inline void		OnArgs (argc_t argc, argv_t argv) noexcept;
     Window		CreateWindow (rcwininfo_t winfo, Window parentWid);
-    inline void		AddConnection (int fd, bool canPassFd = false);
+    CIConn*		AddConnection (int fd, bool canPassFd = false);
     void		RemoveConnection (int fd) noexcept;
     inline CCmdBuf*	LookupConnection (int fd) noexcept;
-    inline void		ActivateClient (CGLWindow& rcli) noexcept;
+    void		ProcessInput (void);
+    void		ProcessRenderResults (void);
+    void		PauseRenderThreads (int fd) noexcept;
+    void		UpdateContextSwitchRate (uint64_t now) noexcept;
+    void		ResumeRenderThreads (void) noexcept;
+    inline void		ScheduleFrame (uint64_t tms)	{ if (tms < _frameClock) WaitForTime (_frameClock = tms); }
+    void		RunFrameClock (uint64_t tms);
+    static inline uint64_t ClientKey (int fd, iid_t iid) noexcept	{ return uint64_t(uint32_t(fd))<<16| iid; }
+    static inline uint64_t ClientKey (const CGLWindow* w) noexcept	{ return ClientKey (w->Fd(), w->IId()); }
+    static inline bool	ClientKeyLess (const CGLWindow* w, uint64_t k)	{ return ClientKey(w) < k; }
+    static inline bool	ClientXidLess (const CGLWindow* w, Window x)	{ return w->Drawable() < x; }
+    void		IndexClient (CGLWindow* pcli);
+    void		UnindexClient (CGLWindow* pcli) noexcept;
     void		DestroyClient (CGLWindow*& pcli) noexcept;
-    void		ForwardError (const char* cmdname, const XError& e, int fd, iid_t iid) noexcept;
     inline void		SetOption (EOption o)	{ _options |= (1<<o); }
     inline iid_t	GenIId (void)		{ return ++_nextiid; }
     inline void		GetAtoms (void) noexcept;
@@ -161,14 +192,28 @@ private:
 private:
     CGLWindow*		_curCli;
     vector<CGLWindow*>	_win;
-    vector<CIConn*>	_iconn;
+    vector<CGLWindow*>	_winByIId;	///< _win sorted by ClientKey
+    vector<CGLWindow*>	_winByXid;	///< _win sorted by Drawable
+    vector<CIConn*>	_iconn;		///< Sorted by fd
+    unique_ptr<CIOThread> _iothread;	///< Reads _iconn when opt_IOThread is set
+    unique_ptr<CRenderResults> _renderResults;	///< From window render threads when opt_RenderThreads is set
+    unique_ptr<CWorkerPool> _workers;	///< Decodes images; created on first use
+    CRecvBuf*		_curInput;	///< Block from _iothread being processed
     Display*		_dpy;
     Window		_rootWindow;
     iid_t		_nextiid;
+    unsigned		_ctxSwitches;		///< glXMakeCurrent calls since _ctxSwitchTime
+    unsigned		_ctxSwitchesSkipped;	///< Loads done in another window's context since _ctxSwitchTime
+    unsigned		_ctxSwitchRate;		///< Per second, over the last full second
+    uint64_t		_ctxSwitchTime;
+    uint64_t		_frameClock;		///< Next tick of the display frame clock
+    vector<CGLWindow*>	_swapQueue;		///< Windows rendered on this tick, to be swapped together
     CFile		_localSocket;
     CFile		_tcpSocket;
     uint8_t		_glversion;
     uint8_t		_options;
+    uint8_t		_glxexts;		///< Bits of EGLXExt supported by the X server
+    int			_glxEventBase;
     Atom		_atoms [a_Last];
     SXDisplay		_dinfo;
     GLXFBConfig		_fbconfig [G::WinInfo::MSAA_MAX+1];
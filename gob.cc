@@ -205,3 +205,50 @@ void CFramebuffer::Free (void) noexcept
 	glDeleteFramebuffers (1, &id);
     }
 }
+
+//----------------------------------------------------------------------
+
+CVertexArray::CVertexArray (GLXContext ctx, goid_t cid, const GLubyte* p, GLuint psz, const CIConn& conn)
+: CGObject (ctx, cid, GenId())
+{
+    try {
+	if (psz % sizeof(G::VertexAttrib))
+	    throw XError ("invalid vertex array attribute block size %u", psz);
+	glBindVertexArray (Id());
+	auto iattr = (const G::VertexAttrib*) p;
+	unsigned nattr = psz / sizeof(G::VertexAttrib);
+	for (auto i = 0u; i < nattr; ++i) {
+	    auto& a = iattr[i];
+	    auto& buf = conn.LookupBuffer (a.buffer);
+	    if (a.slot == G::VertexAttrib::INDEX_SLOT) {
+		DTRACE ("\tIndex buffer %x\n", buf.CId());
+		glBindBuffer (GL_ELEMENT_ARRAY_BUFFER, buf.Id());
+		continue;
+	    } else if (a.slot >= G::VertexAttrib::MAX_SLOTS)
+		throw XError ("invalid vertex attribute slot %hhu", a.slot);
+	    else if ((a.type < G::BYTE || a.type > G::FLOAT) && a.type != G::DOUBLE)
+		throw XError ("invalid vertex attribute type %hx", a.type);
+	    else if (a.size < 1 || a.size > 4)
+		throw XError ("invalid vertex attribute size %hhu", a.size);
+	    DTRACE ("\tAttribute %hhu from buffer %x, type %s[%hhu], +%u/%hu, divisor %hu\n", a.slot, buf.CId(), G::TypeName(a.type), a.size, a.offset, a.stride, a.divisor);
+	    glBindBuffer (GL_ARRAY_BUFFER, buf.Id());
+	    glEnableVertexAttribArray (a.slot);
+	    glVertexAttribPointer (a.slot, a.size, a.type, GL_FALSE, a.stride, (const void*) uintptr_t(a.offset));
+	    glVertexAttribDivisor (a.slot, a.divisor);
+	}
+	glBindVertexArray (0);	// Windows rebind their own before drawing
+    } catch (...) {	// LookupBuffer throws on invalid goid
+	glBindVertexArray (0);
+	Free();
+	throw;
+    }
+}
+
+void CVertexArray::Free (void) noexcept
+{
+    auto id = Id();
+    if (id != NoObject) {
+	ResetId();
+	glDeleteVertexArrays (1, &id);
+    }
+}
@@ -123,3 +123,14 @@ private:
 private:
     GLushort		_w,_h;
 };
+
+//----------------------------------------------------------------------
+
+class CVertexArray : public CGObject {
+public:
+			CVertexArray (GLXContext ctx, goid_t cid, const GLubyte* p, GLuint psz, const CIConn& conn);
+    virtual		~CVertexArray (void) noexcept	{ Free(); }
+private:
+    inline GLuint	GenId (void) const	{ GLuint id; glGenVertexArrays (1, &id); return id; }
+    void		Free (void) noexcept;
+};
@@ -89,4 +89,11 @@ void CShader::Load (const Sources& src)
     for (auto i = 0u; i < Sources::shader_NStages; ++i)
 	if (stages[i] != NoObject)
 	    glDeleteShader (stages[i]);
+
+    // Shaders with the DrawState block read it from the buffer range the window binds to ubo_DrawState
+    auto dsblock = glGetUniformBlockIndex (Id(), "DrawState");
+    if (dsblock != GL_INVALID_INDEX)
+	glUniformBlockBinding (Id(), dsblock, G::ubo_DrawState);
+    _transformSlot = glGetUniformLocation (Id(), "Transform");
+    _colorSlot = glGetUniformLocation (Id(), "Color");
 }
@@ -59,10 +59,16 @@ public:
     //}}}
 public:
     inline		CShader (GLXContext ctx, goid_t cid, const Sources& src)
-			    : CGObject(ctx,cid,glCreateProgram()) { Load(src); }
-    inline		CShader (CShader&& v)			: CGObject(move(v)) {}
-    inline CShader&	operator= (CShader&& v)			{ CGObject::operator= (move(v)); return *this; }
+			    : CGObject(ctx,cid,glCreateProgram()),_transformSlot(-1),_colorSlot(-1) { Load(src); }
+    inline		CShader (CShader&& v)			: CGObject(move(v)),_transformSlot(v._transformSlot),_colorSlot(v._colorSlot) {}
+    inline CShader&	operator= (CShader&& v)			{ CGObject::operator= (move(v)); _transformSlot = v._transformSlot; _colorSlot = v._colorSlot; return *this; }
 			~CShader (void) noexcept;
+			// Plain Transform and Color uniforms of shaders without the DrawState block
+    inline GLint	TransformSlot (void) const		{ return _transformSlot; }
+    inline GLint	ColorSlot (void) const			{ return _colorSlot; }
 private:
     void		Load (const Sources& src);
+private:
+    GLint		_transformSlot;
+    GLint		_colorSlot;
 };
@@ -23,7 +23,9 @@ const int CTexture::CParam::c_Defaults [G::Texture::NPARAMS] = {
     G::Texture::COMPARE_MODE_NONE,	// COMPARE_MODE
     G::Texture::COMPARE_LEQUAL,		// COMPARE_FUNC
     G::Texture::DEPTH_IS_LUMINANCE,	// DEPTH_TEXTURE_MODE
-    false		// GENERATE_MIPMAP
+    false,		// GENERATE_MIPMAP
+    G::Texture::LOAD_SYNC,	// LOAD_MODE
+    false		// ATLAS
 };
 
 const uint16_t CTexture::CParam::c_GLCode [G::Texture::NPARAMS] = {
@@ -41,7 +43,9 @@ const uint16_t CTexture::CParam::c_GLCode [G::Texture::NPARAMS] = {
     GL_TEXTURE_COMPARE_MODE,
     GL_TEXTURE_COMPARE_FUNC,
     GL_DEPTH_TEXTURE_MODE,
-    GL_GENERATE_MIPMAP
+    GL_GENERATE_MIPMAP,
+    0,			// LOAD_MODE is not a GL parameter
+    0			// ATLAS is not a GL parameter
 };
 
 //}}}-------------------------------------------------------------------
@@ -113,16 +117,15 @@ void CTexture::CTexBuf::Load (const GLubyte* p, GLuint psz)
     copy_n (p + h->dataOffset, wsize, _imgd.begin());
 }
 
-void CTexture::CTexBuf::Save (int fd) const
+void CTexture::CTexBuf::Save (FILE* f) const
 {
-    CFile f (fd);
     G::Texture::GLTXHeader h;
     h.info = Info();
     h.dataOffset = sizeof(G::Texture::GLTXHeader) + _imgsz.size() * sizeof(_imgsz[0]);
-    f.Write (&h, sizeof(h));
-    f.Write (&_imgsz[0], _imgsz.size() * sizeof(_imgsz[0]));
-    f.Write (&_imgd[0], _imgd.size() * sizeof(_imgd[0]));
-    f.Detach();
+    if (1 != fwrite (&h, sizeof(h), 1, f)
+	    || _imgsz.size() != fwrite (_imgsz.data(), sizeof(_imgsz[0]), _imgsz.size(), f)
+	    || _imgd.size() != fwrite (_imgd.data(), sizeof(_imgd[0]), _imgd.size(), f))
+	CFile::Error ("write");
 }
 
 //}}}-------------------------------------------------------------------
@@ -131,39 +134,155 @@ void CTexture::CTexBuf::Save (int fd) const
 CTexture::CTexture (GLXContext ctx, goid_t cid)
 : CGObject(ctx,cid,GenId())
 ,_info()
+,_page (nullptr)
+,_ox (0)
+,_oy (0)
 {
 }
 
 CTexture::CTexture (GLXContext ctx, goid_t cid, const GLubyte* p, GLuint psz, G::Pixel::Fmt storeas, G::TextureType ttype, const CParam& param)
 : CGObject (ctx, cid, GenId())
 ,_info()
+,_page (nullptr)
+,_ox (0)
+,_oy (0)
+{
+    Create (Decode (p, psz), storeas, ttype, param);
+}
+
+/// Creates an empty 1x1 texture, to be replaced by Create when the image is decoded
+CTexture::CTexture (GLXContext ctx, goid_t cid, G::TextureType ttype, const CParam& param)
+: CGObject (ctx, cid, GenId())
+,_info()
+,_page (nullptr)
+,_ox (0)
+,_oy (0)
+{
+    _info.type = G::Texture::TypeFromTextureType (ttype);
+    _info.w = _info.h = 1;
+    _info.fmt = G::Pixel::RGBA;
+    _info.comp = G::Pixel::UNSIGNED_BYTE;
+    static const uint32_t c_Blank = 0;
+    glBindTexture (_info.type, Id());
+    SetParameters (ttype, param);
+    glTexImage2D (_info.type, 0, G::Pixel::RGBA, 1, 1, 0, G::Pixel::RGBA, G::Pixel::UNSIGNED_BYTE, &c_Blank);
+}
+
+/// Decodes image data into a texture buffer; safe to call from any thread
+CTexture::CTexBuf CTexture::Decode (const GLubyte* p, GLuint psz) // static
 {
     if (psz < sizeof(G::Texture::GLTXHeader))
 	XError::emit ("invalid texture data");
     auto tbuf = Load (p, psz);
     if (psz > sizeof(G::Texture::GLTXHeader) && !tbuf.Data())
 	XError::emit ("invalid texture data");
-    Create (tbuf, storeas, ttype, param);
+    return tbuf;
 }
 
-void CTexture::Create (const CTexBuf& tbuf, G::Pixel::Fmt storeas, G::TextureType ttype, const CParam& param)
+bool CTexture::IsEncodedImage (const GLubyte* p, GLuint psz) noexcept // static
 {
+    if (psz < sizeof(G::Texture::GLTXHeader))
+	return false;
+    auto& magic = *reinterpret_cast<const uint32_t*>(p);
+    return magic == vpack4(0x89,'P','N','G')
+	|| uint16_t(magic) == vpack2(0xff,0xd8)
+	|| magic == vpack4('G','I','F','8');
+}
+
+void CTexture::Create (const CTexBuf& tbuf, G::Pixel::Fmt storeas, G::TextureType ttype, const CParam& param, bool viaPBO)
+{
+    if (CreateInAtlas (tbuf, storeas, ttype, param))
+	return;
     _info = tbuf.Info();
     _info.type = G::Texture::TypeFromTextureType (ttype);
     glBindTexture (_info.type, Id());
-    for (auto p = 0u; p < G::Texture::NPARAMS; ++p)
-	if (!param.IsDefault (G::Texture::Parameter(p)))
-	    glTexParameteri (_info.type, param.GLCode(G::Texture::Parameter(p)), param.Get (ttype, G::Texture::Parameter(p)));
-    auto pixels = tbuf.Data();
+    SetParameters (ttype, param);
+    const void* pixels = tbuf.Data();
     if (pixels && tbuf.Size() < G::Pixel::TextureSize (_info.fmt, _info.comp, _info.w, _info.h + !_info.h) * (_info.d + !_info.d))
 	XError::emit ("incomplete texture data");
+    GLuint pbo = (pixels && viaPBO) ? BeginPBO (pixels, tbuf.Size()) : 0;
     if (ttype >= G::TEXTURE_3D)
 	glTexImage3D (_info.type, 0, storeas, _info.w, _info.h, _info.d, 0, _info.fmt, _info.comp, pixels);
     else if (ttype >= G::TEXTURE_2D)
 	glTexImage2D (_info.type, _info.d, storeas, _info.w, _info.h, 0, _info.fmt, _info.comp, pixels);
     else
 	glTexImage1D (_info.type, _info.d, storeas, _info.w, 0, _info.fmt, _info.comp, pixels);
-    // Query actual texture parameters
+    EndPBO (pbo);
+    QueryLevelInfo();
+}
+
+/// Creates the texture a sliced upload goes to. This one, the blank
+/// placeholder, is drawn until EndUpload. Returns 0 if \p tbuf is not
+/// a plain 2D image that can be uploaded by rows.
+GLuint CTexture::BeginUpload (const CTexBuf& tbuf, G::Pixel::Fmt storeas, G::TextureType ttype, const CParam& param)
+{
+    auto& ti = tbuf.Info();
+    if (ttype != G::TEXTURE_2D || _page || ti.d || !ti.w || !ti.h || !tbuf.Data()
+	    || tbuf.Size() < G::Pixel::TextureSize (ti.fmt, ti.comp, ti.w, ti.h))
+	return 0;
+    auto id = GenId();
+    glBindTexture (_info.type, id);
+    SetParameters (ttype, param);
+    glTexImage2D (_info.type, 0, storeas, ti.w, ti.h, 0, ti.fmt, ti.comp, nullptr);
+    return id;
+}
+
+void CTexture::UploadRows (GLuint id, const CTexBuf& tbuf, GLushort y, GLushort h) const
+{
+    auto& ti = tbuf.Info();
+    auto rowsz = G::Pixel::TextureSize (ti.fmt, ti.comp, ti.w, 1);
+    const void* pixels = reinterpret_cast<const uint8_t*>(tbuf.Data()) + y*rowsz;
+    glBindTexture (_info.type, id);
+    auto pbo = BeginPBO (pixels, h*rowsz);
+    glTexSubImage2D (_info.type, 0, 0, y, ti.w, h, ti.fmt, ti.comp, pixels);
+    EndPBO (pbo);
+}
+
+/// Replaces the placeholder with the uploaded texture \p id
+void CTexture::EndUpload (GLuint id, const CTexBuf& tbuf)
+{
+    auto oid = Id();
+    if (oid != NoObject)
+	glDeleteTextures (1, &oid);
+    ResetId (id);
+    auto type = _info.type;
+    _info = tbuf.Info();
+    _info.type = type;
+    glBindTexture (_info.type, id);
+    QueryLevelInfo();
+}
+
+/// With a pixel buffer, the driver copies the image to the GPU asynchronously.
+/// On success, the returned buffer is bound and \p pixels becomes an offset into it.
+GLuint CTexture::BeginPBO (const void*& pixels, GLuint sz) noexcept // static
+{
+    GLuint pbo;
+    glGenBuffers (1, &pbo);
+    glBindBuffer (GL_PIXEL_UNPACK_BUFFER, pbo);
+    glBufferData (GL_PIXEL_UNPACK_BUFFER, sz, nullptr, GL_STREAM_DRAW);
+    auto pbuf = glMapBufferRange (GL_PIXEL_UNPACK_BUFFER, 0, sz, GL_MAP_WRITE_BIT| GL_MAP_INVALIDATE_BUFFER_BIT);
+    if (pbuf) {
+	memcpy (pbuf, pixels, sz);
+	glUnmapBuffer (GL_PIXEL_UNPACK_BUFFER);
+	pixels = nullptr;
+	return pbo;
+    }
+    glBindBuffer (GL_PIXEL_UNPACK_BUFFER, 0);
+    glDeleteBuffers (1, &pbo);
+    return 0;
+}
+
+void CTexture::EndPBO (GLuint pbo) noexcept // static
+{
+    if (!pbo)
+	return;
+    glBindBuffer (GL_PIXEL_UNPACK_BUFFER, 0);
+    glDeleteBuffers (1, &pbo);	// Deletion is deferred until the transfer completes
+}
+
+/// Queries actual texture parameters of the bound texture
+void CTexture::QueryLevelInfo (void) noexcept
+{
     GLint tlp;
     glGetTexLevelParameteriv (_info.type, 0, GL_TEXTURE_INTERNAL_FORMAT, &tlp);
     _info.fmt = G::Pixel::Fmt(tlp);	// the actual compressed format, for example
@@ -174,13 +293,56 @@ void CTexture::Create (const CTexBuf& tbuf, G::Pixel::Fmt storeas, G::TextureTyp
     }
 }
 
+void CTexture::SetParameters (G::TextureType ttype, const CParam& param) noexcept
+{
+    for (auto p = 0u; p < G::Texture::NPARAMS; ++p)
+	if (!param.IsDefault (G::Texture::Parameter(p)) && param.GLCode (G::Texture::Parameter(p)))
+	    glTexParameteri (_info.type, param.GLCode(G::Texture::Parameter(p)), param.Get (ttype, G::Texture::Parameter(p)));
+}
+
 void CTexture::Free (void) noexcept
 {
     auto id = Id();
-    if (id != NoObject) {
-	ResetId();
+    if (id == NoObject)
+	return;
+    ResetId();
+    if (_page) {
+	CAtlasPage::Free (_page);
+	_page = nullptr;
+    } else
 	glDeleteTextures (1, &id);
-    }
+}
+
+/// With the ATLAS parameter, small images are copied into a shared atlas page,
+/// for sprites from many of them to be drawn with one texture and one call.
+bool CTexture::CreateInAtlas (const CTexBuf& tbuf, G::Pixel::Fmt storeas, G::TextureType ttype, const CParam& param)
+{
+    const auto& ti = tbuf.Info();
+    if (!param.Get (ttype, G::Texture::ATLAS) || ttype != G::TEXTURE_2D || _page
+	    || (storeas != G::Pixel::RGBA && storeas != G::Pixel::RGB)
+	    || (ti.fmt != G::Pixel::RGBA && ti.fmt != G::Pixel::RGB) || ti.comp != G::Pixel::UNSIGNED_BYTE
+	    || !tbuf.Data() || ti.d || !ti.w || !ti.h
+	    || ti.w > CAtlasPage::c_MaxImageSize || ti.h > CAtlasPage::c_MaxImageSize
+	    || tbuf.Size() < G::Pixel::TextureSize (ti.fmt, ti.comp, ti.w, ti.h))
+	return false;
+    GLushort x, y;
+    auto page = CAtlasPage::Place (ti.w, ti.h, x, y);
+    auto id = Id();
+    if (id != NoObject)
+	glDeleteTextures (1, &id);
+    ResetId (page->Id());
+    _page = page;
+    _info = ti;
+    _info.type = G::Texture::TypeFromTextureType (ttype);
+    _info.fmt = G::Pixel::RGBA;
+    _info.size = ti.w*ti.h*4;
+    // Sprite source y is top-down from the top of the texture, while image rows go up from y
+    _ox = x;
+    _oy = CAtlasPage::c_Size - y - ti.h;
+    DTRACE ("Texture %x packed into atlas page %x at %hux%hu+%hu+%hu\n", CId(), page->Id(), ti.w, ti.h, x, y);
+    glBindTexture (GL_TEXTURE_2D, page->Id());
+    glTexSubImage2D (GL_TEXTURE_2D, 0, x, y, ti.w, ti.h, ti.fmt, ti.comp, tbuf.Data());
+    return true;
 }
 
 CTexture::CTexBuf CTexture::Load (const GLubyte* p, GLuint psz) // static
@@ -204,24 +366,85 @@ CTexture::CTexBuf CTexture::Load (const GLubyte* p, GLuint psz) // static
 	XError::emit ("unrecognized image file format");
 }
 
-void CTexture::Save (int fd, GLuint x, GLuint y, GLuint w, GLuint h, G::Texture::Format fmt, uint8_t quality) // static
+/// Writes \p tbuf, containing packed RGB rows, to \p f; safe to call from any thread
+void CTexture::Encode (FILE* f, const CTexBuf& tbuf, G::Texture::Format fmt, uint8_t quality, EncodeSpeed speed) // static
 {
-    CTexBuf tbuf (G::Pixel::RGB, G::Pixel::UNSIGNED_BYTE, w, w*4, h);
-    glReadPixels (x, y, w, h, tbuf.Info().fmt, tbuf.Info().comp, tbuf.Data());
     if (fmt == G::Texture::Format::GLTX)
-	tbuf.Save (fd);
+	tbuf.Save (f);
     #if __has_include(<png.h>)
     else if (fmt == G::Texture::Format::PNG)
-	SavePNG (fd, tbuf);
+	SavePNG (f, tbuf, speed);
     #endif
     #if __has_include(<jpeglib.h>)
     else if (fmt == G::Texture::Format::JPEG)
-	SaveJPG (fd, tbuf, quality);
+	SaveJPG (f, tbuf, quality, speed);
     #endif
     else
 	XError::emit ("unrecognized image file format");
 }
 
+//}}}-------------------------------------------------------------------
+//{{{ CAtlasPage
+
+vector<CTexture::CAtlasPage*> CTexture::CAtlasPage::s_Pages;
+
+CTexture::CAtlasPage::CAtlasPage (void)
+:_shelves()
+,_id (0)
+,_freey (0)
+,_nImages (0)
+{
+    glGenTextures (1, &_id);
+    glBindTexture (GL_TEXTURE_2D, _id);
+    glTexParameteri (GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);	// Mipmaps would blend neighboring images
+    glTexParameteri (GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri (GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexImage2D (GL_TEXTURE_2D, 0, GL_RGBA8, c_Size, c_Size, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+}
+
+/// Finds space for a w x h image in the first shelf it fits, or starts a new one
+bool CTexture::CAtlasPage::Alloc (GLushort w, GLushort h, GLushort& x, GLushort& y) noexcept
+{
+    const GLushort pw = w+c_Padding, ph = h+c_Padding;
+    SShelf* best = nullptr;
+    for (auto& s : _shelves)	// Of those that fit, the lowest wastes the least
+	if (s.h >= ph && c_Size-s.x >= pw && (!best || s.h < best->h))
+	    best = &s;
+    if (!best) {
+	if (c_Size-_freey < ph)
+	    return false;
+	_shelves.push_back (SShelf { _freey, ph, 0 });
+	_freey += ph;
+	best = &_shelves.back();
+    }
+    x = best->x;
+    y = best->y;
+    best->x += pw;
+    ++_nImages;
+    return true;
+}
+
+CTexture::CAtlasPage* CTexture::CAtlasPage::Place (GLushort w, GLushort h, GLushort& x, GLushort& y) // static
+{
+    for (auto p : s_Pages)
+	if (p->Alloc (w, h, x, y))
+	    return p;
+    auto p = new CAtlasPage;
+    s_Pages.push_back (p);
+    p->Alloc (w, h, x, y);
+    return p;
+}
+
+/// Space is reclaimed only when the page is emptied, so short-lived images should not be packed
+void CTexture::CAtlasPage::Free (CAtlasPage* page) noexcept // static
+{
+    if (!page->Release())
+	return;
+    DTRACE ("Atlas page %x is empty, freeing\n", page->Id());
+    s_Pages.erase (find (s_Pages.begin(), s_Pages.end(), page));
+    delete page;
+}
+
 //}}}-------------------------------------------------------------------
 //{{{ GLTX format
 
@@ -298,11 +521,8 @@ CTexture::CTexBuf CTexture::LoadPNG (const GLubyte* p, GLuint sz) // static
     return tbuf;
 }
 
-void CTexture::SavePNG (int fd, const CTexBuf& tbuf) // static
+void CTexture::SavePNG (FILE* outfile, const CTexBuf& tbuf, EncodeSpeed speed) // static
 {
-    auto outfile = fdopen (fd, "wb");
-    if (!outfile)
-	XError::emit ("failed to open output png file");
     auto png_ptr = png_create_write_struct (PNG_LIBPNG_VER_STRING, nullptr, nullptr, nullptr);
     png_infop info_ptr = nullptr;
     if (png_ptr)
@@ -312,6 +532,13 @@ void CTexture::SavePNG (int fd, const CTexBuf& tbuf) // static
 	XError::emit ("failed to write output png file");
     }
     png_init_io (png_ptr, outfile);
+    if (speed == EncodeSpeed::FASTEST) {
+	png_set_compression_level (png_ptr, 1);
+	png_set_filter (png_ptr, PNG_FILTER_TYPE_BASE, PNG_FILTER_SUB);
+    } else if (speed == EncodeSpeed::SMALLEST) {
+	png_set_compression_level (png_ptr, 9);
+	png_set_filter (png_ptr, PNG_FILTER_TYPE_BASE, PNG_ALL_FILTERS);
+    }
 
     png_set_IHDR (png_ptr, info_ptr, tbuf.Info().w, tbuf.Info().h,
 		8, PNG_COLOR_TYPE_RGB, PNG_INTERLACE_NONE,
@@ -373,11 +600,8 @@ CTexture::CTexBuf CTexture::LoadJPG (const GLubyte* p, GLuint psz) // static
     return imgbuf;
 }
 
-void CTexture::SaveJPG (int fd, const CTexBuf& tbuf, uint8_t quality) // static
+void CTexture::SaveJPG (FILE* outfile, const CTexBuf& tbuf, uint8_t quality, EncodeSpeed speed) // static
 {
-    auto outfile = fdopen (fd, "wb");
-    if (!outfile)
-	XError::emit ("failed to open output jpg file");
     jpeg_compress_struct cinfo;
     jpeg_error_mgr jerr;
     cinfo.err = jpeg_std_error (&jerr);
@@ -390,6 +614,10 @@ void CTexture::SaveJPG (int fd, const CTexBuf& tbuf, uint8_t quality) // static
     cinfo.in_color_space = JCS_RGB;
     jpeg_set_defaults (&cinfo);
     jpeg_set_quality (&cinfo, quality, TRUE);
+    if (speed == EncodeSpeed::FASTEST)
+	cinfo.dct_method = JDCT_IFAST;
+    else if (speed == EncodeSpeed::SMALLEST)
+	cinfo.optimize_coding = TRUE;
     jpeg_start_compress (&cinfo, TRUE);
 
     auto ppix = const_cast<JSAMPROW>(reinterpret_cast<const GLubyte*>(tbuf.Data()));
@@ -398,9 +626,9 @@ void CTexture::SaveJPG (int fd, const CTexBuf& tbuf, uint8_t quality) // static
 	pline[i] = &ppix[((cinfo.image_height-1)-i)*cinfo.image_width*3];
     jpeg_write_scanlines (&cinfo, pline, cinfo.image_height);
 
-    fflush (outfile);
     jpeg_finish_compress (&cinfo);
     jpeg_destroy_compress (&cinfo);
+    fflush (outfile);
 }
 
 #endif
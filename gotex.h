@@ -25,19 +25,27 @@ public:
 	c_MaxHeight = c_MaxWidth
     };
     using rcti_t	= const G::Texture::Info&;
+    class CAtlasPage;
 public:
 			CTexture (GLXContext ctx, goid_t cid, const GLubyte* p, GLuint psz, G::Pixel::Fmt storeas, G::TextureType ttype, const CParam& param);
     inline		~CTexture (void) noexcept { Free(); }
-    inline explicit	CTexture (CTexture&& v)	: CGObject(move(v)),_info(v._info) {}
-    inline CTexture&	operator= (CTexture&& v){ CGObject::operator= (move(v)); _info = move(v._info); return *this; }
+    inline explicit	CTexture (CTexture&& v)	: CGObject(move(v)),_info(v._info),_page(v._page),_ox(v._ox),_oy(v._oy) { v._page = nullptr; }
+    inline CTexture&	operator= (CTexture&& v){ CGObject::operator= (move(v)); _info = move(v._info); swap (_page, v._page); _ox = v._ox; _oy = v._oy; return *this; }
     inline rcti_t	Info (void) const	{ return _info; }
     inline GLenum	Type (void) const	{ return Info().type; }
     inline GLushort	Width (void) const	{ return Info().w; }
     inline GLushort	Height (void) const	{ return Info().h; }
     inline GLushort	Depth (void) const	{ return Info().d; }
+			/// The GL texture is shared with other images when packed into an atlas
+			/// page. Sprite source coordinates must then be offset by OriginX,OriginY.
+    inline GLushort	TextureWidth (void) const;
+    inline GLushort	TextureHeight (void) const;
+    inline GLushort	OriginX (void) const	{ return _ox; }
+    inline GLushort	OriginY (void) const	{ return _oy; }
     void		Free (void) noexcept;
-    static void		Save (int fd, GLuint x, GLuint y, GLuint w, GLuint h, G::Texture::Format, uint8_t quality);
-protected:
+    using EncodeSpeed	= G::Texture::EncodeSpeed;
+    static bool		IsEncodedImage (const GLubyte* p, GLuint psz) noexcept;
+public:
     class CTexBuf {
     public:
 	using texhdr_t		= G::Texture::GLTXHeader;
@@ -57,30 +65,80 @@ protected:
 	inline rcti_t		Info (void) const	{ return _info; }
 	void			Resize (uint16_t w, uint32_t roww, uint16_t h);
 	void			Load (const GLubyte* p, GLuint psz);
-	void			Save (int fd) const;
+	void			Save (FILE* f) const;
     private:
 	G::Texture::Info	_info;
 	vector<uint8_t>		_imgd;
 	vector<uint32_t>	_imgsz;
     };
+public:
+				CTexture (GLXContext ctx, goid_t cid, G::TextureType ttype, const CParam& param);
+    static CTexBuf		Decode (const GLubyte* p, GLuint psz);
+    static void			Encode (FILE* f, const CTexBuf& tbuf, G::Texture::Format fmt, uint8_t quality, EncodeSpeed speed);
+    void			Create (const CTexBuf& tbuf, G::Pixel::Fmt storeas, G::TextureType ttype, const CParam& param, bool viaPBO = false);
+				// Uploading a large image in slices, see CTextureLoad
+    GLuint			BeginUpload (const CTexBuf& tbuf, G::Pixel::Fmt storeas, G::TextureType ttype, const CParam& param);
+    void			UploadRows (GLuint id, const CTexBuf& tbuf, GLushort y, GLushort h) const;
+    void			EndUpload (GLuint id, const CTexBuf& tbuf);
 protected:
 				CTexture (GLXContext ctx, goid_t cid);
     inline GLuint		GenId (void) const	{ GLuint id; glGenTextures (1, &id); return id; }
-    void			Create (const CTexBuf& tbuf, G::Pixel::Fmt storeas, G::TextureType ttype, const CParam& param);
 private:
+    void			SetParameters (G::TextureType ttype, const CParam& param) noexcept;
+    void			QueryLevelInfo (void) noexcept;
+    static GLuint		BeginPBO (const void*& pixels, GLuint sz) noexcept;
+    static void			EndPBO (GLuint pbo) noexcept;
+    bool			CreateInAtlas (const CTexBuf& tbuf, G::Pixel::Fmt storeas, G::TextureType ttype, const CParam& param);
     static inline CTexBuf	Load (const GLubyte* p, GLuint psz);
     static CTexBuf		LoadGLTX (const GLubyte* p, GLuint psz);
 #if __has_include(<png.h>)
     static CTexBuf		LoadPNG (const GLubyte* p, GLuint psz);
-    static void			SavePNG (int fd, const CTexBuf& tbuf);
+    static void			SavePNG (FILE* f, const CTexBuf& tbuf, EncodeSpeed speed);
 #endif
 #if __has_include(<jpeglib.h>)
     static inline CTexBuf	LoadJPG (const GLubyte* p, GLuint psz);
-    static inline void		SaveJPG (int fd, const CTexBuf& tbuf, uint8_t quality);
+    static inline void		SaveJPG (FILE* f, const CTexBuf& tbuf, uint8_t quality, EncodeSpeed speed);
 #endif
 #if __has_include(<gif_lib.h>)
     static inline CTexBuf	LoadGIF (const GLubyte* p, GLuint psz);
 #endif
 protected:
     G::Texture::Info		_info;
+private:
+    CAtlasPage*			_page;	///< Holding this image, if packed into an atlas
+    GLushort			_ox,_oy;
 };
+
+//----------------------------------------------------------------------
+
+/// A texture shared by small images, allocated in shelves of rows
+class CTexture::CAtlasPage {
+public:
+    enum {
+	c_Size = 1024,
+	c_MaxImageSize = 256,
+	c_Padding = 1		///< Between images, for filtering to not bleed into neighbors
+    };
+public:
+				CAtlasPage (void);
+				~CAtlasPage (void) noexcept	{ glDeleteTextures (1, &_id); }
+    inline GLuint		Id (void) const			{ return _id; }
+    bool			Alloc (GLushort w, GLushort h, GLushort& x, GLushort& y) noexcept;
+    inline bool			Release (void) noexcept		{ return !--_nImages; }
+    static CAtlasPage*		Place (GLushort w, GLushort h, GLushort& x, GLushort& y);
+    static void			Free (CAtlasPage* page) noexcept;
+private:
+    struct SShelf {
+	GLushort		y,h;
+	GLushort		x;	///< Free space starts here
+    };
+private:
+    vector<SShelf>		_shelves;
+    GLuint			_id;
+    GLushort			_freey;	///< Below the last shelf
+    unsigned			_nImages;
+    static vector<CAtlasPage*>	s_Pages;
+};
+
+GLushort CTexture::TextureWidth (void) const	{ return _page ? GLushort(CAtlasPage::c_Size) : Width(); }
+GLushort CTexture::TextureHeight (void) const	{ return _page ? GLushort(CAtlasPage::c_Size) : Height(); }
@@ -0,0 +1,163 @@
+// This file is part of the GLERI project
+//
+// Copyright (c) 2012 by Mike Sharov <msharov@users.sourceforge.net>
+// This file is free software, distributed under the MIT License.
+
+#include "gthread.h"
+#include "gleri/mmfile.h"
+#include <signal.h>
+#include <syslog.h>
+
+//{{{ CThread ----------------------------------------------------------
+
+void CThread::Start (void)
+{
+    assert (!_running && "Thread already started");
+    _running = true;	// Set first, for Running to be true on the new thread
+    if (0 != pthread_create (&_thread, nullptr, ThreadProc, this)) {
+	_running = false;
+	CFile::Error ("pthread_create");
+    }
+}
+
+void CThread::Join (void) noexcept
+{
+    if (!_running)
+	return;
+    pthread_join (_thread, nullptr);
+    _running = false;
+}
+
+void* CThread::ThreadProc (void* p) noexcept // static
+{
+    // Signals are handled by the main thread's event loop
+    sigset_t sset;
+    sigfillset (&sset);
+    pthread_sigmask (SIG_BLOCK, &sset, nullptr);
+    try {
+	static_cast<CThread*>(p)->Run();
+    } catch (XError& e) {
+	syslog (LOG_ERR, "thread terminated: %s", e.what());
+    }
+    return nullptr;
+}
+
+//}}}-------------------------------------------------------------------
+//{{{ CWakePipe
+
+CWakePipe::CWakePipe (void)
+{
+    if (0 > pipe (_p))
+	CFile::Error ("pipe");
+    for (auto fd : _p) {
+	fcntl (fd, F_SETFL, fcntl (fd, F_GETFL)| O_NONBLOCK);
+	fcntl (fd, F_SETFD, FD_CLOEXEC);
+    }
+}
+
+CWakePipe::~CWakePipe (void) noexcept
+{
+    close (_p[0]);
+    close (_p[1]);
+}
+
+void CWakePipe::Signal (void) noexcept
+{
+    static const char c = 0;
+    while (0 > write (_p[1], &c, sizeof(c)) && errno == EINTR) {}	// EAGAIN means already signaled
+}
+
+void CWakePipe::Clear (void) noexcept
+{
+    char buf [64];
+    for (ssize_t br; 0 < (br = read (_p[0], buf, sizeof(buf))) || (br < 0 && errno == EINTR);) {}
+}
+
+//}}}-------------------------------------------------------------------
+//{{{ CWorkerPool
+
+CWorkerPool::CWorkerPool (void)
+:_workers()
+,_queue()
+,_done()
+,_pending (0)
+,_quitting (false)
+,_lock()
+,_jobReady()
+,_jobDone()
+,_doneSignal()
+{
+    auto nw = min<long> (max<long> (sysconf (_SC_NPROCESSORS_ONLN), 1), c_MaxWorkers);
+    for (auto i = 0; i < nw; ++i) {
+	_workers.push_back (new CWorker (*this));
+	_workers.back()->Start();
+    }
+}
+
+CWorkerPool::~CWorkerPool (void) noexcept
+{
+    _lock.Lock();
+    _quitting = true;
+    _jobReady.Broadcast();
+    _lock.Unlock();
+    for (auto w : _workers)
+	delete w;
+    for (auto j : _queue)
+	delete j;
+    for (auto j : _done)
+	delete j;
+}
+
+void CWorkerPool::Post (CJob* j)
+{
+    _lock.Lock();
+    _queue.push_back (j);
+    ++_pending;
+    _jobReady.Broadcast();
+    _lock.Unlock();
+}
+
+void CWorkerPool::RunJobs (void) noexcept
+{
+    _lock.Lock();
+    for (;;) {
+	while (_queue.empty() && !_quitting)
+	    _jobReady.Wait (_lock);
+	if (_quitting)
+	    break;
+	auto j = _queue.front();
+	_queue.erase (_queue.begin());
+	_lock.Unlock();
+	j->Run();
+	_lock.Lock();
+	_done.push_back (j);
+	_jobDone.Broadcast();
+	_doneSignal.Signal();
+    }
+    _lock.Unlock();
+}
+
+void CWorkerPool::FinishJobs (void) noexcept
+{
+    vector<CJob*> done;
+    _lock.Lock();
+    _doneSignal.Clear();
+    done.swap (_done);
+    _pending -= done.size();
+    _lock.Unlock();
+    for (auto j : done) {
+	if (j->Finish())
+	    delete j;
+    }
+}
+
+/// Blocks until at least one job is ready for FinishJobs
+void CWorkerPool::WaitForJob (void) noexcept
+{
+    _lock.Lock();
+    while (_done.empty() && _pending)
+	_jobDone.Wait (_lock);
+    _lock.Unlock();
+}
+
+//}}}-------------------------------------------------------------------
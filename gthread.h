@@ -0,0 +1,155 @@
+// This file is part of the GLERI project
+//
+// Copyright (c) 2012 by Mike Sharov <msharov@users.sourceforge.net>
+// This file is free software, distributed under the MIT License.
+
+#pragma once
+#include "config.h"
+#include "gleri/gldefs.h"
+#include <pthread.h>
+
+//{{{ CThread ----------------------------------------------------------
+
+/// Runs Run() on a separate thread with all signals blocked.
+/// Derived classes must call Join in their destructor.
+class CThread {
+public:
+    inline		CThread (void) noexcept	:_thread(),_running(false) {}
+    virtual		~CThread (void) noexcept	{ assert (!_running && "Join the thread in the derived destructor"); }
+    void		Start (void);
+    void		Join (void) noexcept;
+    inline bool		Running (void) const	{ return _running; }
+protected:
+    virtual void	Run (void) = 0;
+private:
+    static void*	ThreadProc (void* p) noexcept;
+private:
+    pthread_t		_thread;
+    bool		_running;
+};
+
+//}}}-------------------------------------------------------------------
+//{{{ CMutex and CCondition
+
+class CMutex {
+public:
+    inline		CMutex (void) noexcept	{ pthread_mutex_init (&_m, nullptr); }
+    inline		~CMutex (void) noexcept	{ pthread_mutex_destroy (&_m); }
+    inline void		Lock (void) noexcept	{ pthread_mutex_lock (&_m); }
+    inline void		Unlock (void) noexcept	{ pthread_mutex_unlock (&_m); }
+    inline pthread_mutex_t* Handle (void)	{ return &_m; }
+private:
+    pthread_mutex_t	_m;
+};
+
+class CCondition {
+public:
+    inline		CCondition (void) noexcept	{ pthread_cond_init (&_c, nullptr); }
+    inline		~CCondition (void) noexcept	{ pthread_cond_destroy (&_c); }
+    inline void		Wait (CMutex& m) noexcept	{ pthread_cond_wait (&_c, m.Handle()); }
+			/// Waits until \p ms on the CApp::NowMS clock
+    inline void		WaitUntil (CMutex& m, uint64_t ms) noexcept
+			    { timespec ts = { time_t(ms/1000), long(ms%1000*1000000) }; pthread_cond_timedwait (&_c, m.Handle(), &ts); }
+    inline void		Broadcast (void) noexcept	{ pthread_cond_broadcast (&_c); }
+private:
+    pthread_cond_t	_c;
+};
+
+//}}}-------------------------------------------------------------------
+//{{{ CWakePipe
+
+/// A pipe for waking up a thread sleeping in poll
+class CWakePipe {
+public:
+			CWakePipe (void);
+			~CWakePipe (void) noexcept;
+    inline int		Fd (void) const		{ return _p[0]; }
+    void		Signal (void) noexcept;
+    void		Clear (void) noexcept;
+private:
+    int			_p[2];
+};
+
+//}}}-------------------------------------------------------------------
+//{{{ CSPSCQueue
+
+/// Lock-free queue with one producer thread and one consumer thread
+template <typename T, unsigned N>
+class CSPSCQueue {
+    static_assert (!(N&(N-1)), "CSPSCQueue size must be a power of 2");
+public:
+    inline		CSPSCQueue (void) noexcept	:_head(0),_pad(),_tail(0),_q() {}
+    inline bool		empty (void) const	{ return __atomic_load_n (&_tail, __ATOMIC_ACQUIRE) == __atomic_load_n (&_head, __ATOMIC_ACQUIRE); }
+    inline bool		full (void) const	{ return __atomic_load_n (&_tail, __ATOMIC_ACQUIRE) - __atomic_load_n (&_head, __ATOMIC_ACQUIRE) >= N; }
+    inline bool		push (const T& v) noexcept {
+			    auto t = __atomic_load_n (&_tail, __ATOMIC_RELAXED);
+			    if (t - __atomic_load_n (&_head, __ATOMIC_ACQUIRE) >= N)
+				return false;
+			    _q[t%N] = v;
+			    __atomic_store_n (&_tail, t+1, __ATOMIC_RELEASE);
+			    return true;
+			}
+    inline bool		pop (T& v) noexcept {
+			    auto h = __atomic_load_n (&_head, __ATOMIC_RELAXED);
+			    if (h == __atomic_load_n (&_tail, __ATOMIC_ACQUIRE))
+				return false;
+			    v = _q[h%N];
+			    __atomic_store_n (&_head, h+1, __ATOMIC_RELEASE);
+			    return true;
+			}
+private:
+    unsigned		_head;
+    char		_pad [64-sizeof(unsigned)];	// Keeps _head and _tail on separate cache lines
+    unsigned		_tail;
+    T			_q [N];
+};
+
+//}}}-------------------------------------------------------------------
+//{{{ CWorkerPool
+
+/// Runs jobs on a set of worker threads.
+/// Job completion is signaled on Fd, after which FinishJobs must be
+/// called on the main thread to run each job's Finish and delete it,
+/// unless Finish returns false to keep the job for more work.
+///
+class CWorkerPool {
+public:
+    class CJob {
+    public:
+	virtual			~CJob (void) noexcept {}
+	virtual void		Run (void) noexcept = 0;	///< Called on a worker thread
+	virtual bool		Finish (void) noexcept = 0;	///< Called on the main thread; false if the job is kept
+    };
+    enum { c_MaxWorkers = 4 };
+public:
+			CWorkerPool (void);
+			~CWorkerPool (void) noexcept;
+    inline int		Fd (void) const		{ return _doneSignal.Fd(); }
+    void		Post (CJob* j);
+    void		FinishJobs (void) noexcept;
+    void		WaitForJob (void) noexcept;
+private:
+    class CWorker : public CThread {
+    public:
+	inline explicit	CWorker (CWorkerPool& pool)	:CThread(),_pool(pool) {}
+	inline		~CWorker (void) noexcept	{ Join(); }
+    protected:
+	virtual void	Run (void) override		{ _pool.RunJobs(); }
+    private:
+	CWorkerPool&	_pool;
+    };
+private:
+    void		RunJobs (void) noexcept;
+private:
+    vector<CWorker*>	_workers;
+    vector<CJob*>	_queue;
+    vector<CJob*>	_done;
+    unsigned		_pending;	///< Jobs posted and not yet done
+    bool		_quitting;
+    CMutex		_lock;
+    CCondition		_jobReady;
+    CCondition		_jobDone;
+    CWakePipe		_doneSignal;
+};
+
+//}}}-------------------------------------------------------------------
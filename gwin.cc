@@ -3,8 +3,10 @@
 // Copyright (c) 2012 by Mike Sharov <msharov@users.sourceforge.net>
 // This file is free software, distributed under the MIT License.
 
-#include "gwin.h"
+#include "gleris.h"
+#include "fbsave.h"
 #include <sys/time.h>
+#include <math.h>
 
 //{{{ GLWindow window-level functionality ------------------------------
 
@@ -12,14 +14,61 @@ CGLWindow::CGLWindow (iid_t iid, const WinInfo& winfo, Window win, GLXContext ct
 : PRGLR(iid)
 ,_ctx (ctx,iid,win)
 ,_pendingFrame()
+,_lastFrame()
+,_sprites()
+,_spriteTex (nullptr)
+,_drawCmds()
+,_drawAttrs()
+,_drawMode (G::POINTS)
+,_readbacks()
+,_freePbo()
+,_capture()
+,_captureBuf()
+,_captureSkip (0)
+,_rthread()
 ,_pconn (pconn)
 ,_proj {0}
 ,_color (0xffffffff)
 ,_query {0}
 ,_vao {CGObject::NoObject}
+,_clientVao (CGObject::NoObject)
+,_streamBuf (0)
+,_indirectBuf (0)
+,_drawStateBuf (0)
+,_drawStateOffset (c_DrawStateBufSize)
+,_drawStateStep (sizeof(SDrawState))
+,_drawStateChanged (true)
+,_transformSlot (-1)
+,_colorSlot (-1)
 ,_syncEvent (CEvent::VSync, c_DefaultFrameTimeNS)
 ,_nextVSync (NotWaitingForVSync)
 ,_lastVSync (0)
+,_frameFence (nullptr)
+,_swapSbc (0)
+,_presentUST (0)
+,_lastPresentUST (0)
+,_droppedFrames (0)
+,_frameSeq (0)
+,_swapSeq (0)
+,_presentMode (G::PresentMode::VSYNC)
+,_hidden (false)
+,_scaledFb (0)
+,_scaledRb {0}
+,_scaledSz {0,0}
+,_resScale (100)
+,_scaledDraw (false)
+,_bufferAge (0)
+,_damage()
+,_pastDamage()
+,_copyDamage()
+,_damageCopied (false)
+,_lastFrameGen (0)
+,_lastFrameDrawn (false)
+,_redrawReq (false)
+,_animating (false)
+,_animEpoch (CApp::NowMS())
+,_animStart (_animEpoch)
+,_animTime (_animEpoch)
 ,_curShaderId (CGObject::NoObject)
 ,_curShader (G::GoidNull)
 ,_curBuffer (G::GoidNull)
@@ -34,6 +83,7 @@ CGLWindow::CGLWindow (iid_t iid, const WinInfo& winfo, Window win, GLXContext ct
     DTRACE ("[%x] Create: window %x, context %x\n", iid, win, ctx);
     _winfo.h = 0;	// Make invalid until explicit resize
     _texparam.Set (G::TEXTURE_2D, G::Texture::MIN_FILTER, G::Texture::NEAREST);	// Default texture MIN_FILTER is NEAREST_MIPMAP_LINEAR, which does not work with non-mipmapped textures
+    ResetDamage();
 }
 
 void CGLWindow::Activate (void)
@@ -44,22 +94,47 @@ void CGLWindow::Activate (void)
     }
 }
 
-void CGLWindow::Init (void)
+void CGLWindow::Init (Display* dpy)
 {
     glEnable (GL_BLEND);
     glEnable (GL_CULL_FACE);
     glEnable (GL_SCISSOR_TEST);
     glBlendFunc (GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-    glXSwapIntervalSGI (1);
+    glPixelStorei (GL_PACK_ALIGNMENT, 1);	// SaveFramebuffer encoders expect packed rows
+    SetPresentMode (dpy, G::PresentMode::VSYNC);
     glGenQueries (ArraySize(_query), _query);
     glGenVertexArrays (ArraySize(_vao), _vao);
+    _clientVao = _vao[0];
+    glGenBuffers (1, &_streamBuf);
+    glGenBuffers (1, &_indirectBuf);
+    glGenBuffers (1, &_drawStateBuf);
+    GLint uboAlign = 1;
+    glGetIntegerv (GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &uboAlign);
+    _drawStateStep = (sizeof(SDrawState)+uboAlign-1)/uboAlign*uboAlign;
     Activate();
 }
 
 CGLWindow::~CGLWindow (void) noexcept
 {
+    _rthread.reset();
+    _capture.reset();
+    for (auto& r : _readbacks) {
+	glDeleteSync (r.fence);
+	_freePbo.push_back (r.pbo);
+    }
+    if (!_freePbo.empty())
+	glDeleteBuffers (_freePbo.size(), _freePbo.data());
+    if (_frameFence)
+	glDeleteSync (_frameFence);
     glDeleteQueries (ArraySize(_query), _query);
     glDeleteVertexArrays (ArraySize(_vao), _vao);
+    glDeleteBuffers (1, &_streamBuf);
+    glDeleteBuffers (1, &_indirectBuf);
+    glDeleteBuffers (1, &_drawStateBuf);
+    if (_scaledFb) {
+	glDeleteFramebuffers (1, &_scaledFb);
+	glDeleteRenderbuffers (ArraySize(_scaledRb), _scaledRb);
+    }
 }
 
 void CGLWindow::Deactivate (void)
@@ -75,7 +150,10 @@ void CGLWindow::Resize (int16_t x, int16_t y, uint16_t w, uint16_t h) noexcept
 	return;
     _fbsz.w = _winfo.w = w;
     _fbsz.h = _winfo.h = h;
-    Viewport (0, 0, w, h);
+    ResetDamage();	// The back buffers are reallocated
+    __atomic_store_n (&_lastFrameGen, 0, __ATOMIC_RELAXED);	// and the client must draw a frame of the new size
+    // The viewport is set from _winfo when the next frame binds the default framebuffer,
+    // so there is no need to activate the context here.
     PRGLR::Restate (_winfo);
 }
 
@@ -89,19 +167,133 @@ void CGLWindow::Viewport (GLint x, GLint y, GLsizei w, GLsizei h) noexcept
     _viewport.w = w;
     _viewport.h = h;
     memset (_proj, 0, sizeof(_proj));
-    y = _fbsz.h-y-h;
-    glViewport (x,y,w,h);
-    glScissor (x,y,w,h);
+    SetViewportRect();
     Scale (1, 1);
     Offset (0, 0);
 }
 
+void CGLWindow::SetViewportRect (void) noexcept
+{
+    GLint x = _viewport.x, y = _fbsz.h-_viewport.y-_viewport.h, w = _viewport.w, h = _viewport.h;
+    if (_scaledDraw) {	// Coordinates remain in window pixels; only the rendered area shrinks
+	auto x2 = ((x+w)*_resScale+99)/100, y2 = ((y+h)*_resScale+99)/100;
+	x = x*_resScale/100;
+	y = y*_resScale/100;
+	w = x2-x;
+	h = y2-y;
+    }
+    glViewport (x,y,w,h);
+    if (_bufferAge && !_damage.empty() && !_scaledDraw && _curFb == G::default_Framebuffer) {
+	// The back buffer has the rest of the window from earlier frames, so
+	// only the damage since then is drawn: this frame's and the past age-1
+	auto d = _damage;
+	for (auto i = 0u; i < _bufferAge-1u; ++i)
+	    d.Add (_pastDamage[i]);
+	auto x2 = min (x+w, d.x2), y2 = min (y+h, _fbsz.h-d.y1);
+	x = max (x, d.x1);
+	y = max (y, _fbsz.h-d.y2);
+	w = max (x2-x, 0);
+	h = max (y2-y, 0);
+    }
+    glScissor (x,y,w,h);
+}
+
+void CGLWindow::Damage (coord_t x, coord_t y, dim_t w, dim_t h) noexcept
+{
+    DTRACE ("[%x] Damage %hux%hu+%hd+%hd\n", IId(), w,h,x,y);
+    _damage.Add (SDamage { x, y, x+w, y+h });
+    if (_curFb == G::default_Framebuffer)
+	SetViewportRect();
+}
+
+//{{{2 Animation
+
+/// Animation progress, 0 to 1, at the present time of the frame being drawn
+float CGLWindow::AnimationPhase (uint32_t periodms, G::Animation a) noexcept
+{
+    if (!periodms)
+	return 1.f;
+    if (a == G::Animation::ONCE) {
+	auto t = _animTime - _animStart;
+	if (t >= periodms)
+	    return 1.f;
+	_animating = true;
+	return float(t)/periodms;
+    }
+    _animating = true;
+    auto p = float((_animTime - _animEpoch) % periodms)/periodms;
+    if (a == G::Animation::PINGPONG)
+	p = 1.f - fabsf (2.f*p - 1.f);
+    return p;
+}
+
+void CGLWindow::AnimateColor (GLuint c1, GLuint c2, uint32_t periodms, G::Animation a) noexcept
+{
+    auto p = AnimationPhase (periodms, a);
+    GLuint c = 0;
+    for (auto s = 0u; s < 32; s += 8) {
+	auto v1 = (c1 >> s) & UINT8_MAX, v2 = (c2 >> s) & UINT8_MAX;
+	c |= GLuint(v1 + (int(v2)-int(v1))*p + 0.5f) << s;
+    }
+    Color (c);
+}
+
+void CGLWindow::AnimateOffset (coord_t x1, coord_t y1, coord_t x2, coord_t y2, uint32_t periodms, G::Animation a) noexcept
+{
+    auto p = AnimationPhase (periodms, a);
+    Offset (lroundf (x1 + (x2-x1)*p), lroundf (y1 + (y2-y1)*p));
+}
+
+void CGLWindow::AnimateUniform (const char* varname, const GLfloat* v1, const GLfloat* v2, uint32_t periodms, G::Animation a) noexcept
+{
+    auto p = AnimationPhase (periodms, a);
+    GLfloat v[4];
+    for (auto i = 0u; i < ArraySize(v); ++i)
+	v[i] = v1[i] + (v2[i]-v1[i])*p;
+    Uniform4fv (varname, v);
+}
+
+//}}}2
+/// Gets the age of the back buffer, for frames with damage to draw only that
+void CGLWindow::BeginDamage (Display* dpy) noexcept
+{
+    if (_bufferAge)	// The last frame failed while drawing, so its changes are unknown
+	ResetDamage();
+    _damage = _copyDamage = SDamage();
+    unsigned age = 0;	// Unknown, so everything is drawn
+    if (_damageCopied)	// Not swapped since the last frame was drawn into it
+	age = 1;
+    else if (CGleris::Instance().HaveGLXExt (CGleris::glxext_EXTBufferAge))
+	glXQueryDrawable (dpy, Drawable(), GLX_BACK_BUFFER_AGE_EXT, &age);
+    _bufferAge = age <= c_MaxDamageAge ? age : 0;
+}
+
+/// GLX has no swap with damage, but without vsync, the damage can be
+/// copied to the front buffer with MESA_copy_sub_buffer. Such frames
+/// are done when their fence is, like other frames not waiting for vsync.
+/// With vsync, a copy would tear and would not advance the swap counter
+/// the frame pacing waits on, so those frames are always swapped.
+void CGLWindow::EndDamage (seq_t seq) noexcept
+{
+    for (auto i = ArraySize(_pastDamage)-1; i; --i)
+	_pastDamage[i] = _pastDamage[i-1];
+    if (_damage.empty() || _scaledDraw)	// Frames without damage change the whole window
+	_pastDamage[0] = SDamage { 0, 0, INT16_MAX, INT16_MAX };
+    else {
+	_pastDamage[0] = _damage;
+	// Redraws, with seq 0, restore exposed areas, so replace the whole window
+	if (seq && PresentMode() == G::PresentMode::IMMEDIATE && CGleris::Instance().HaveGLXExt (CGleris::glxext_MESACopySubBuffer))
+	    _copyDamage = SDamage { max (_damage.x1, 0), max (_damage.y1, 0), min<int> (_damage.x2, _fbsz.w), min<int> (_damage.y2, _fbsz.h) };
+    }
+    _bufferAge = 0;	// Offscreen drawlists are not clipped
+}
+
 void CGLWindow::Offset (GLint x, GLint y) noexcept
 {
     DTRACE ("[%x] Offset %hd:%hd\n", IId(), x,y);		// OpenGL 0,0 is at screen center, screen width 2
     _proj[3][0] = float(-(_viewport.w-2*x-1))/_viewport.w;	// 0.5 pixel center adjustment (w=2,1/w adjusts by 0.5)
     _proj[3][1] = float(_viewport.h-2*y-1)/_viewport.h;		// Same as x, but with y inverted the adjustment is +up
-    UniformMatrix ("Transform", Proj());
+    TransformChanged();
 }
 
 void CGLWindow::Scale (float x, float y) noexcept
@@ -111,7 +303,14 @@ void CGLWindow::Scale (float x, float y) noexcept
     _proj[1][1] = -2.f*y/_viewport.h;				// invert y to 0,0 at top left
     _proj[2][2] = 1;
     _proj[3][3] = 1;
-    UniformMatrix ("Transform", Proj());
+    TransformChanged();
+}
+
+void CGLWindow::TransformChanged (void) noexcept
+{
+    _drawStateChanged = true;
+    if (_transformSlot >= 0)
+	glUniformMatrix4fv (_transformSlot, 1, GL_FALSE, Proj());
 }
 
 void CGLWindow::ParseDrawlist (goid_t fbid, bstri cmdis)
@@ -120,63 +319,293 @@ void CGLWindow::ParseDrawlist (goid_t fbid, bstri cmdis)
     glBindVertexArray (_vao[0]);
     for (auto i = 0u; i < MAX_VAO_SLOTS; ++i)
 	glDisableVertexAttribArray (i);
+    _clientVao = _vao[0];
     // Clear GL state remembered from the previous frame
     _curShader = _curBuffer = _curTexture = _curFont = G::GoidNull;
+    _sprites.clear();	// Of a drawlist that failed
+    _spriteTex = nullptr;
+    _drawCmds.clear();
+    _drawAttrs.clear();
     BindFramebuffer (LookupFramebuffer (fbid), G::FRAMEBUFFER);
     // Now that everything is reset, parse the drawlist
     PDraw<bstri>::Parse (*this, cmdis);
+    if (fbid != G::default_Framebuffer)	// Frames drawn from framebuffer textures change
+	_pconn->Changed();
+}
+
+uint64_t CGLWindow::DrawFrame (CDrawlist& f, Display* dpy)
+{
+    if (!PollFrame (dpy))	// The frame is not drawn until the previous one is done; callers check PollFrame first
+	return _nextVSync;
+    if (RenderFrame (f, dpy))
+	SwapFrame (dpy);
+    return _nextVSync;
 }
 
-uint64_t CGLWindow::DrawFrame (bstri cmdis, Display* dpy)
-{
-    if (_nextVSync != NotWaitingForVSync) {
-	DTRACE ("[%x] Waiting for vsync: ", IId());
-	bool bHaveQuery;
-	for (auto n = 0u; !(bHaveQuery = QueryResultAvailable(_query[query_FrameEnd])) && ++n < 64;)
-	    usleep(256);
-	if (bHaveQuery) {
-	    uint64_t times[ArraySize(_query)];	// Query times are in ns
-	    for (auto i = 0u; i < ArraySize(_query); ++i)
-		glGetQueryObjectui64v (_query[i], GL_QUERY_RESULT, &times[i]);
-	    _syncEvent.time = times[query_RenderEnd] - times[query_RenderBegin];
-	    // Update refresh rate after two consecutive frames.
-	    if (uint64_t(times[query_RenderBegin] - _lastVSync) < LastFrameTime()/2)
+/// Draws \p f, keeping it to redraw on Expose, or, if \p f is not a frame,
+/// redraws the kept frame if requested. Returns true if it must be swapped.
+bool CGLWindow::RenderFrame (CDrawlist& f, Display* dpy)
+{
+    auto redraw = __atomic_exchange_n (&_redrawReq, false, __ATOMIC_RELAXED) || _animating;
+    _animTime = CApp::NowMS() + LastFrameTime()/1000000;
+    if (!f.Seq()) {
+	if (!redraw || !CanRedraw())
+	    return false;
+	DTRACE ("[%x] Redrawing the last frame\n", IId());
+	return RenderFrame (_lastFrame.Stream(), 0, dpy);
+    }
+    auto same = _lastFrameDrawn && SameAsLastFrame (f.Stream());
+    if (!same)
+	_animStart = _animTime;
+    if (same && !redraw && !_capture) {
+	// Nothing would change, so the frame is acknowledged at the next vsync without drawing it
+	DTRACE ("[%x] Frame %hu same as the last, not drawn\n", IId(), f.Seq());
+	_swapSeq = f.Seq();
+	_swapSbc = 0;
+	_nextVSync = CApp::NowMS() + LastFrameTime()/1000000;
+	return false;
+    }
+    auto r = RenderFrame (f.Stream(), f.Seq(), dpy);
+    if (!f.empty()) {
+	_lastFrame.swap (f);
+	_lastFrameDrawn = r;
+	__atomic_store_n (&_lastFrameGen, _pconn->Generation(), __ATOMIC_RELAXED);
+    }
+    return r;
+}
+
+/// Drawlists can be the same while the resources they use are not
+bool CGLWindow::SameAsLastFrame (const bstri& cmdis) const noexcept
+{
+    auto last = _lastFrame.Stream();
+    return _lastFrameGen == _pconn->Generation()
+	&& cmdis.remaining() == last.remaining()
+	&& !memcmp (cmdis.ipos(), last.ipos(), last.remaining());
+}
+
+/// Draws the frame without presenting it. Returns true if it must be swapped with SwapFrame.
+bool CGLWindow::RenderFrame (bstri cmdis, seq_t seq, Display* dpy)
+{
+    if (!cmdis.remaining()) {	// empty drawlist, must acknowledge with a sync event, but no need to wait
+	if (seq)
+	    _syncEvent.x = seq;
+	PostSyncEvent();
+	return false;
+    }
+    if (Hidden()) {	// Not drawn, but acknowledged at a throttled rate, as if on vsync
+	DTRACE ("[%x] Skipping frame %hu of hidden window\n", IId(), seq);
+	_swapSeq = seq;
+	_swapSbc = 0;
+	_nextVSync = CApp::NowMS() + c_HiddenFrameMS;
+	return false;
+    }
+    DTRACE ("[%x] Parsing drawlist\n", IId());
+    PostQuery (_query[query_RenderBegin]);
+
+    BeginDamage (dpy);
+    _animating = false;
+    ParseDrawlist (G::default_Framebuffer, cmdis);
+    if (_scaledDraw)
+	ResolveScaledFramebuffer();
+    if (_capture)
+	CaptureFrame();
+    EndDamage (seq);
+
+    PostQuery (_query[query_RenderEnd]);
+    _swapSeq = seq;
+    return true;
+}
+
+/// End of frame swap and queries
+void CGLWindow::SwapFrame (Display* dpy)
+{
+    if (PresentMode() == G::PresentMode::IMMEDIATE)	// The swap does not wait for vsync, so the frame is done as soon as drawn
+	_nextVSync = CApp::NowMS() + c_FramePollMS;
+    else
+	_nextVSync = CApp::NowMS() + LastFrameTime()/5*4/1000000;	// subtract 1/5 of vsync interval to shift frame submit time back toward actual vsync
+    if (!_copyDamage.empty()) {	// Only the damage changed, see EndDamage
+	glXCopySubBufferMESA (dpy, Drawable(), _copyDamage.x1, _fbsz.h-_copyDamage.y2, _copyDamage.x2-_copyDamage.x1, _copyDamage.y2-_copyDamage.y1);
+	_swapSbc = 0;
+	_damageCopied = true;
+    } else {
+	if (_damageCopied)	// Ages of the other back buffers do not count the copied frames
+	    ResetDamage();
+	if (CGleris::Instance().HaveGLXExt (CGleris::glxext_OMLSyncControl))
+	    _swapSbc = glXSwapBuffersMscOML (dpy, Drawable(), 0, 0, 0);	// Same as glXSwapBuffers, but returns the swap count to wait for
+	else
+	    glXSwapBuffers (dpy, Drawable());
+    }
+    PostQuery (_query[query_FrameEnd]);
+    _frameFence = glFenceSync (GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+/// Renders the pending frame, if the previous one is done. Returns true if it must be swapped with SwapFrame.
+bool CGLWindow::RenderPendingFrame (Display* dpy)
+{
+    if (!PollFrame (dpy))
+	return false;
+    CDrawlist f;
+    TakePendingFrame (f);
+    return RenderFrame (f, dpy);
+}
+
+/// Only the latest frame is drawn; the one replaced is dropped and the client told so
+void CGLWindow::SetPendingFrame (const bstri& cmdis, CRecvBuf* src, seq_t seq)
+{
+    if (_pendingFrame.Seq())
+	DropFrame (_pendingFrame.Seq());
+    _pendingFrame.assign (cmdis, src, seq);
+}
+
+/// Puts back a frame from TakePendingFrame that could not be drawn yet, unless replaced since
+void CGLWindow::RestorePendingFrame (CDrawlist& f)
+{
+    if (!_pendingFrame.Seq())
+	_pendingFrame.swap (f);
+    else if (f.Seq())
+	DropFrame (f.Seq());
+    f.clear();
+}
+
+void CGLWindow::DropFrame (seq_t seq)
+{
+    CEvent e (CEvent::FrameDropped, ++_droppedFrames, seq);
+    DTRACE ("[%x] Dropped frame %hu, %u so far\n", IId(), seq, _droppedFrames);
+    if (HasRenderThread())
+	_rthread->PostEvent (e);
+    else
+	Event (e);
+}
+
+/// Checks, without waiting, if the last frame is done, and sends its VSync if so.
+/// Returns false and reschedules _nextVSync for another poll if not.
+bool CGLWindow::PollFrame (Display* dpy)
+{
+    if (_nextVSync == NotWaitingForVSync)
+	return true;
+    if (_swapSbc && !_presentUST) {
+	int64_t ust, msc, sbc;
+	if (!glXGetSyncValuesOML (dpy, Drawable(), &ust, &msc, &sbc))
+	    _swapSbc = 0;	// Timing falls back to the queries
+	else if (sbc < _swapSbc) {
+	    _nextVSync = CApp::NowMS() + c_FramePollMS;
+	    return false;
+	} else if (glXWaitForSbcOML (dpy, Drawable(), _swapSbc, &ust, &msc, &sbc))	// Returns at once for a completed swap
+	    _presentUST = ust;
+    }
+    if (_frameFence && GL_TIMEOUT_EXPIRED == glClientWaitSync (_frameFence, GL_SYNC_FLUSH_COMMANDS_BIT, 0)) {
+	_nextVSync = CApp::NowMS() + c_FramePollMS;
+	return false;
+    }
+    FinishFrame();
+    _nextVSync = NotWaitingForVSync;
+    return true;
+}
+
+// GLX_INTEL_swap_event reports the present time of each swap, so it need not be polled
+uint64_t CGLWindow::SwapComplete (int64_t ust, int64_t sbc) noexcept
+{
+    if (_nextVSync == NotWaitingForVSync || !_swapSbc || sbc < _swapSbc)
+	return CApp::NoTimer;
+    _presentUST = ust;
+    return _nextVSync = CApp::NowMS();
+}
+
+void CGLWindow::FinishFrame (void)
+{
+    if (_frameFence) {
+	glDeleteSync (_frameFence);
+	_frameFence = nullptr;
+	uint64_t times[ArraySize(_query)];	// Query times are in ns, available since the fence was signaled
+	for (auto i = 0u; i < ArraySize(_query); ++i)
+	    glGetQueryObjectui64v (_query[i], GL_QUERY_RESULT, &times[i]);
+	_syncEvent.time = times[query_RenderEnd] - times[query_RenderBegin];
+	// Update refresh rate after two consecutive frames.
+	if (uint64_t(times[query_RenderBegin] - _lastVSync) < LastFrameTime()/2) {
+	    if (_presentUST && _lastPresentUST)
+		_syncEvent.key = (_presentUST - _lastPresentUST)*1000;
+	    else
 		_syncEvent.key = times[query_FrameEnd] - _lastVSync;
-	    _lastVSync = times[query_FrameEnd];
-	    DTRACE ("Got it. Draw time %u ns, refresh %u ns\n", _syncEvent.time, _syncEvent.key);
-	} else	// technically should never happen, but timing out avoids a hang in case of driver problems
-	    DTRACE ("query lost\n");
-	Event (_syncEvent);
-	_nextVSync = NotWaitingForVSync;
+	}
+	_lastVSync = times[query_FrameEnd];
+	DTRACE ("[%x] Frame done. Draw time %u ns, refresh %u ns\n", IId(), _syncEvent.time, _syncEvent.key);
+	PaceNextFrame();
+	ScaleResolution();
     }
-    if (cmdis.remaining()) {
-	_nextVSync = CApp::NowMS() + LastFrameTime()/((5/4)*1000000);	// subtract 1/5 of vsync interval to shift frame submit time back toward actual vsync
-	DTRACE ("[%x] Parsing drawlist\n", IId());
-	PostQuery (_query[query_RenderBegin]);
+    _lastPresentUST = _presentUST;
+    _presentUST = 0;
+    _syncEvent.x = _swapSeq;
+    if (_swapSeq || !_animating)	// Animation frames are not the client's
+	PostSyncEvent();
+}
 
-	ParseDrawlist (G::default_Framebuffer, cmdis);
+/// Computes the latest time, in ms from now, at which the client may submit
+/// the next frame for it to be drawn before the following vsync. The client
+/// waits that long before building the drawlist to use the most recent input.
+/// It is sent in the y field of VSync events.
+void CGLWindow::PaceNextFrame (void) noexcept
+{
+    SetSubmitDelay (0);	// Unthrottled modes draw as soon as a frame arrives
+    if (PresentMode() != G::PresentMode::VSYNC && PresentMode() != G::PresentMode::ADAPTIVE)
+	return;
+    int64_t slack = int64_t(LastFrameTime()) - LastRenderTime() - c_SubmitMarginNS;
+    if (_presentUST) {	// The frame may have been presented a while ago if polled
+	timespec ts;	// OML UST is CLOCK_MONOTONIC microseconds on Linux
+	clock_gettime (CLOCK_MONOTONIC, &ts);
+	auto nowus = uint64_t(ts.tv_sec)*1000000 + ts.tv_nsec/1000;
+	if (nowus > _presentUST)
+	    slack -= min<uint64_t> (nowus - _presentUST, LastFrameTime()/1000)*1000;
+    }
+    if (slack > 0)
+	SetSubmitDelay (slack/1000000);
+    DTRACE ("[%x] Next frame due in %hu ms\n", IId(), uint16_t(_syncEvent.y));
+}
 
-	// End of frame swap and queries
-	PostQuery (_query[query_RenderEnd]);
-	glXSwapBuffers (dpy, Drawable());
-	PostQuery (_query[query_FrameEnd]);
-    } else
-	Event (_syncEvent);	// empty drawlist, must acknowledge with a sync event, but no need to wait
-    return _nextVSync;
+void CGLWindow::SetSubmitDelay (unsigned ms) noexcept
+{
+    _syncEvent.y = min (ms, unsigned(UINT16_MAX));
 }
 
-uint64_t CGLWindow::DrawFrameNoWait (bstri cmdis, Display* dpy)
+/// Sets the swap interval for \p m, falling back to VSYNC when unsupported.
+/// The mode in effect is sent to the client in a PresentMode event.
+void CGLWindow::SetPresentMode (Display* dpy, G::PresentMode m)
 {
-    if (_nextVSync != NotWaitingForVSync) {
-	_pendingFrame.assign (cmdis.ipos(), cmdis.end());
-	return _nextVSync;
+    using G::PresentMode;
+    const auto& app = CGleris::Instance();
+    if (m == PresentMode::ADAPTIVE && !app.HaveGLXExt (CGleris::glxext_EXTSwapControlTear))
+	m = PresentMode::VSYNC;
+    // MAILBOX swaps on vsync; frames are not throttled because only the latest pending one is drawn
+    auto interval = m == PresentMode::IMMEDIATE ? 0 : (m == PresentMode::ADAPTIVE ? -1 : 1);
+    if (app.HaveGLXExt (CGleris::glxext_EXTSwapControl))
+	glXSwapIntervalEXT (dpy, Drawable(), interval);
+    else if (app.HaveGLXExt (CGleris::glxext_MESASwapControl))
+	glXSwapIntervalMESA (interval);
+    else {
+	if (!interval) {	// SGI_swap_control can not turn off vsync
+	    m = PresentMode::VSYNC;
+	    interval = 1;
+	}
+	glXSwapIntervalSGI (interval);
     }
-    return DrawFrame (cmdis, dpy);
+    DTRACE ("[%x] Present mode %u, swap interval %d\n", IId(), unsigned(m), interval);
+    _presentMode = m;
+    SetSubmitDelay (0);
+    Event (CEvent (CEvent::PresentMode, unsigned(m)));
+}
+
+void CGLWindow::PostSyncEvent (void)
+{
+    if (HasRenderThread())	// The command buffer is written only by the main thread
+	_rthread->PostEvent (_syncEvent);
+    else
+	Event (_syncEvent);
 }
 
-uint64_t CGLWindow::DrawPendingFrame (Display* dpy)
+void CGLWindow::StartRenderThread (Display* dpy, CRenderResults& results)
 {
-    return DrawFrame (bstri (&*_pendingFrame.begin(), _pendingFrame.size()), dpy);
+    DTRACE ("[%x] Starting render thread\n", IId());
+    _rthread.reset (new CRenderThread (dpy, *this, results));
+    _rthread->Start();
 }
 
 //}}}-------------------------------------------------------------------
@@ -202,9 +631,15 @@ void CGLWindow::Shader (const CShader& sh) noexcept
     SetShaderId (sh.Id());
     SetShader (sh.CId());
     glUseProgram (sh.Id());
-    glBindVertexArray (_vao[sh.CId() == G::default_FontShader]);
-    UniformMatrix ("Transform", Proj());
-    Color (Color());
+    glBindVertexArray (sh.CId() == G::default_FontShader ? _vao[1] : sh.CId() == G::default_TextureShader ? _vao[2] : _clientVao);
+    // The DrawState block stays bound across shader switches; only client shaders with plain uniforms need them set
+    if ((_transformSlot = sh.TransformSlot()) >= 0)
+	glUniformMatrix4fv (_transformSlot, 1, GL_FALSE, Proj());
+    if ((_colorSlot = sh.ColorSlot()) >= 0) {
+	float r,g,b,a;
+	UnpackColorToFloats (Color(),r,g,b,a);
+	glUniform4f (_colorSlot, r,g,b,a);
+    }
 }
 
 void CGLWindow::Parameter (const char* varname, const CBuffer& buf, G::Type type, GLuint nels, GLuint offset, GLuint stride) noexcept
@@ -261,13 +696,32 @@ void CGLWindow::UniformTexture (const char* varname, const CTexture& t, GLuint i
     glUniform1i (slot, itex);
 }
 
+/// Binds a range of \p buf to uniform \p binding, and \p block of the current shader to it
+void CGLWindow::UniformBuffer (const char* block, GLuint binding, const CBuffer& buf, GLuint offset, GLuint size) noexcept
+{
+    if (binding < G::ubo_ClientFirst || binding > G::ubo_ClientLast)
+	return;	// ubo_DrawState belongs to the server
+    DTRACE ("[%x] UniformBuffer %s = %x at %u, %u bytes from %u\n", IId(), block ? block : "", buf.CId(), binding, size, offset);
+    if (block && block[0] && Shader() != G::GoidNull) {
+	auto bi = glGetUniformBlockIndex (ShaderId(), block);
+	if (bi != GL_INVALID_INDEX)
+	    glUniformBlockBinding (ShaderId(), bi, binding);
+    }
+    if (size)
+	glBindBufferRange (GL_UNIFORM_BUFFER, binding, buf.Id(), offset, size);
+    else
+	glBindBufferBase (GL_UNIFORM_BUFFER, binding, buf.Id());
+}
+
 void CGLWindow::Color (GLuint c) noexcept
 {
     SetColor(c);
     float r,g,b,a;
     UnpackColorToFloats (c,r,g,b,a);
     DTRACE ("[%x] Color 0x%08x\n", IId(), c);
-    Uniform4f ("Color", r, g, b, a);
+    _drawStateChanged = true;
+    if (_colorSlot >= 0)
+	glUniform4f (_colorSlot, r, g, b, a);
 }
 
 void CGLWindow::Clear (GLuint c) noexcept
@@ -285,6 +739,49 @@ void CGLWindow::DrawCmdInit (void) noexcept
 	SetDefaultShader();
 }
 
+/// Queues a flat shader draw to be merged with the following ones until the shader, vertex layout, or other state changes
+void CGLWindow::QueueDraw (G::Shape mode, GLuint first, GLuint count)
+{
+    if (!_drawCmds.empty() && _drawMode != mode)
+	FlushDraws();
+    _drawMode = mode;
+    _drawCmds.push_back (SDrawArraysCmd { count, 1, first, GLuint(_drawCmds.size()) });
+    SDrawAttrs a = { _proj[3][0], _proj[3][1], 0, 0, 0, 0 };
+    UnpackColorToFloats (Color(), a.r, a.g, a.b, a.a);
+    _drawAttrs.push_back (a);
+}
+
+/// Draws queued draws with one glMultiDrawArraysIndirect, each instance getting its offset and color from _drawAttrs
+void CGLWindow::FlushDraws (void)
+{
+    if (_drawCmds.empty())
+	return;
+    DTRACE ("[%x] Merging %zu draws of %s\n", IId(), _drawCmds.size(), G::ShapeName(_drawMode));
+    Shader (_pconn->MergedDrawShader());
+    UploadDrawState();
+    StreamVertices (_drawAttrs.data(), _drawAttrs.size()*sizeof(SDrawAttrs));
+    glEnableVertexAttribArray (c_DrawOffsetSlot);
+    glEnableVertexAttribArray (c_DrawColorSlot);
+    glVertexAttribPointer (c_DrawOffsetSlot, 2, GL_FLOAT, GL_FALSE, sizeof(SDrawAttrs), 0);
+    glVertexAttribPointer (c_DrawColorSlot, 4, GL_FLOAT, GL_FALSE, sizeof(SDrawAttrs), BufferOffset(2*sizeof(GLfloat)));
+    glVertexAttribDivisor (c_DrawOffsetSlot, 1);
+    glVertexAttribDivisor (c_DrawColorSlot, 1);
+    GLint clientIndirect = 0;	// The client's DrawArraysIndirect may use it later without rebinding
+    glGetIntegerv (GL_DRAW_INDIRECT_BUFFER_BINDING, &clientIndirect);
+    glBindBuffer (GL_DRAW_INDIRECT_BUFFER, _indirectBuf);
+    glBufferData (GL_DRAW_INDIRECT_BUFFER, _drawCmds.size()*sizeof(SDrawArraysCmd), _drawCmds.data(), GL_STREAM_DRAW);
+    glMultiDrawArraysIndirect (_drawMode, nullptr, _drawCmds.size(), 0);
+    glBindBuffer (GL_DRAW_INDIRECT_BUFFER, clientIndirect);
+    // The slots are in the client's vertex array, where Parameter does not expect them
+    glVertexAttribDivisor (c_DrawOffsetSlot, 0);
+    glVertexAttribDivisor (c_DrawColorSlot, 0);
+    glDisableVertexAttribArray (c_DrawOffsetSlot);
+    glDisableVertexAttribArray (c_DrawColorSlot);
+    _drawCmds.clear();
+    _drawAttrs.clear();
+    SetDefaultShader();	// Queueing required it, so the next command expects it
+}
+
 void CGLWindow::Enable (G::Feature f, uint16_t o) noexcept
 {
     //{{{2 c_Features, parallel to G::Feature
@@ -330,28 +827,120 @@ void CGLWindow::Enable (G::Feature f, uint16_t o) noexcept
 
 void CGLWindow::Sprite (const CTexture& t, coord_t x, coord_t y)
 {
-    DTRACE ("[%x] Sprite %x at %d:%d\n", IId(), t.CId(), x,y);
-    SetTextureShader();
-    UniformTexture ("Texture", t);
+    Sprite (t, x, y, 0, 0, t.Width(), t.Height());
+}
+
+/// Sprites are queued while consecutive ones use the same texture, to draw them all with one call
+void CGLWindow::Sprite (const CTexture& t, coord_t x, coord_t y, coord_t sx, coord_t sy, dim_t sw, dim_t sh)
+{
+    DTRACE ("[%x] Sprite %x at %d:%d, src %ux%u+%d+%d\n", IId(), t.CId(), x,y, sw,sh,sx,sy);
+    if (!_spriteTex || _spriteTex->Id() != t.Id()) {	// Images in the same atlas page share the texture
+	FlushSprites();
+	_spriteTex = &t;
+    }
     // Solid primitives have the far edge unfilled, for example, 0,0-4,4
     // will draw a 3x3 square. Because y coordinate is inverted, the 3x3
     // is at the bottom left, with top and right pixel strips unfilled.
     // Consequently, to draw a WxH image, need to draw to a (W+1)x(H+1)
     // triangle strip (created by geometry shader), and offset y by -1.
-    Uniform4f ("ImageRect", x, y-1, t.Width(), t.Height());
-    Uniform4f ("SpriteRect", 0, 0, t.Width(), t.Height());
-    glDrawArrays (GL_POINTS, 0, 1);
+    _sprites.push_back (SSprite { x, GLshort(y-1), GLshort(sw), GLshort(sh), GLshort(sx+t.OriginX()), GLshort(sy+t.OriginY()) });
 }
 
-void CGLWindow::Sprite (const CTexture& t, coord_t x, coord_t y, coord_t sx, coord_t sy, dim_t sw, dim_t sh)
+void CGLWindow::Sprites (const CTexture& t, const SpriteRect* r, uint32_t n)
 {
-    DTRACE ("[%x] Sprite %x at %d:%d, src %ux%u+%d+%d\n", IId(), t.CId(), x,y, sw,sh,sx,sy);
+    DTRACE ("[%x] %u sprites of %x\n", IId(), n, t.CId());
+    if (!_spriteTex || _spriteTex->Id() != t.Id()) {
+	FlushSprites();
+	_spriteTex = &t;
+    }
+    _sprites.reserve (_sprites.size()+n);
+    for (auto i = 0u; i < n; ++i)
+	_sprites.push_back (SSprite { r[i].x, GLshort(r[i].y-1), GLshort(r[i].sw), GLshort(r[i].sh), GLshort(r[i].sx+t.OriginX()), GLshort(r[i].sy+t.OriginY()) });
+}
+
+void CGLWindow::FlushSprites (void)
+{
+    if (_sprites.empty())
+	return;
+    const auto& t = *_spriteTex;
+    DTRACE ("[%x] Drawing %zu sprites of %x\n", IId(), _sprites.size(), t.CId());
     SetTextureShader();
     UniformTexture ("Texture", t);
-    // See Sprite above for explanation of -1 and WxH
-    Uniform4f ("ImageRect", x, y-1, t.Width(), t.Height());
-    Uniform4f ("SpriteRect", sx, sy, sw, sh);
-    glDrawArrays (GL_POINTS, 0, 1);
+    Uniform4f ("TextureSize", t.TextureWidth(), t.TextureHeight(), t.TextureWidth(), t.TextureHeight());
+    DrawQuads (_sprites.data(), _sprites.size());
+    _sprites.clear();
+    _spriteTex = nullptr;
+}
+
+/// Draws a quad for each of \p v with the current texture or font shader
+void CGLWindow::DrawQuads (const SSprite* v, GLsizei n) noexcept
+{
+    UploadDrawState();
+    StreamVertices (v, n*sizeof(SSprite));
+    glEnableVertexAttribArray (G::param_Vertex);
+    glEnableVertexAttribArray (G::param_TexCoord);
+    glVertexAttribPointer (G::param_Vertex, 4, GL_SHORT, GL_FALSE, sizeof(SSprite), 0);
+    glVertexAttribPointer (G::param_TexCoord, 2, GL_SHORT, GL_FALSE, sizeof(SSprite), BufferOffset(4*sizeof(GLshort)));
+    if (CIConn::InstancedQuads()) {	// Each vertex is an instance of a 4 vertex strip
+	glVertexAttribDivisor (G::param_Vertex, 1);
+	glVertexAttribDivisor (G::param_TexCoord, 1);
+	glDrawArraysInstanced (GL_TRIANGLE_STRIP, 0, 4, n);
+    } else
+	glDrawArrays (GL_POINTS, 0, n);
+}
+
+/// Loads \p v into the stream buffer, bound as the array buffer
+void CGLWindow::StreamVertices (const void* v, GLsizeiptr vsz) noexcept
+{
+    glBindBuffer (GL_ARRAY_BUFFER, _streamBuf);
+    glBufferData (GL_ARRAY_BUFFER, vsz, v, GL_STREAM_DRAW);	// Orphans the old data, so its draws need not finish first
+    SetBuffer (G::GoidNull);	// For BindBuffer to rebind the client's buffer
+}
+
+/// Writes the draw state to the next SDrawState in _drawStateBuf and binds it to ubo_DrawState
+void CGLWindow::UploadDrawState (void) noexcept
+{
+    if (!_drawStateChanged)
+	return;
+    glBindBuffer (GL_COPY_WRITE_BUFFER, _drawStateBuf);
+    if (_drawStateOffset+sizeof(SDrawState) > c_DrawStateBufSize) {
+	glBufferData (GL_COPY_WRITE_BUFFER, c_DrawStateBufSize, nullptr, GL_STREAM_DRAW);	// Orphans the old states, so their draws need not finish first
+	_drawStateOffset = 0;
+    }
+    // Ranges past the last one written since orphaning are not used by any draw, so no sync is needed
+    auto ds = (SDrawState*) glMapBufferRange (GL_COPY_WRITE_BUFFER, _drawStateOffset, sizeof(SDrawState), GL_MAP_WRITE_BIT| GL_MAP_INVALIDATE_RANGE_BIT| GL_MAP_UNSYNCHRONIZED_BIT);
+    if (!ds)
+	return;
+    copy_n (Proj(), ArraySize(ds->transform), ds->transform);
+    UnpackColorToFloats (Color(), ds->color[0], ds->color[1], ds->color[2], ds->color[3]);
+    ds->viewport[0] = _viewport.x;
+    ds->viewport[1] = _viewport.y;
+    ds->viewport[2] = _viewport.w;
+    ds->viewport[3] = _viewport.h;
+    glUnmapBuffer (GL_COPY_WRITE_BUFFER);
+    glBindBufferRange (GL_UNIFORM_BUFFER, G::ubo_DrawState, _drawStateBuf, _drawStateOffset, sizeof(SDrawState));
+    _drawStateOffset += _drawStateStep;
+    _drawStateChanged = false;
+}
+
+//}}}-------------------------------------------------------------------
+//{{{ Vertex array
+
+/// Binds a client vertex array for drawing with client shaders, or the default one if \p id is null
+void CGLWindow::BindVertexArray (goid_t id)
+{
+    DTRACE ("[%x] BindVertexArray %x\n", IId(), id);
+    if (id == G::GoidNull)
+	_clientVao = _vao[0];
+    else {
+	auto& va = LookupVertexArray (id);
+	if (va.Context() != ContextId())	// Vertex arrays are not shared between contexts
+	    throw XError ("vertex array %x was created by another window", id);
+	_clientVao = va.Id();
+    }
+    if (Shader() != G::GoidNull && Shader() != G::default_FontShader && Shader() != G::default_TextureShader)
+	glBindVertexArray (_clientVao);
+    SetBuffer (G::GoidNull);	// The element array binding is a part of the vertex array
 }
 
 //}}}-------------------------------------------------------------------
@@ -362,7 +951,13 @@ void CGLWindow::BindFramebuffer (const CFramebuffer& fb, G::FramebufferType bind
     DTRACE ("[%x] Bind framebuffer %x to target %u\n", IId(), fb.CId(), bindas);
     static const GLenum c_Target[] = { GL_FRAMEBUFFER, GL_READ_FRAMEBUFFER };
     GLenum targ = c_Target [min<uint8_t>(bindas, ArraySize(c_Target)-1)];
-    glBindFramebuffer (targ, fb.Id());
+    auto id = fb.Id();
+    if (targ == GL_FRAMEBUFFER) {
+	_scaledDraw = !id && _resScale < 100;
+	if (_scaledDraw)
+	    id = ScaledFramebuffer();
+    }
+    glBindFramebuffer (targ, id);
     _curFb = fb.CId();
     auto w = fb.Width(), h = fb.Height();
     if (!fb.Id()) {
@@ -372,7 +967,68 @@ void CGLWindow::BindFramebuffer (const CFramebuffer& fb, G::FramebufferType bind
     Viewport (0, 0, _fbsz.w = w, _fbsz.h = h);
 }
 
-void CGLWindow::SaveFramebuffer (coord_t x, coord_t y, coord_t w, coord_t h, const char* filename, G::Texture::Format fmt, uint8_t quality)
+/// The window-sized scaled framebuffer, drawn from the origin to _resScale percent of each side
+GLuint CGLWindow::ScaledFramebuffer (void)
+{
+    if (!_scaledFb) {
+	glGenFramebuffers (1, &_scaledFb);
+	glGenRenderbuffers (ArraySize(_scaledRb), _scaledRb);
+    }
+    if (_scaledSz.w != _winfo.w || _scaledSz.h != _winfo.h) {
+	DTRACE ("[%x] Allocating %hux%hu scaled framebuffer\n", IId(), _winfo.w, _winfo.h);
+	glBindRenderbuffer (GL_RENDERBUFFER, _scaledRb[0]);
+	glRenderbufferStorage (GL_RENDERBUFFER, GL_RGBA8, _winfo.w, _winfo.h);
+	glBindRenderbuffer (GL_RENDERBUFFER, _scaledRb[1]);
+	glRenderbufferStorage (GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, _winfo.w, _winfo.h);
+	glBindRenderbuffer (GL_RENDERBUFFER, 0);
+	glBindFramebuffer (GL_FRAMEBUFFER, _scaledFb);
+	glFramebufferRenderbuffer (GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, _scaledRb[0]);
+	glFramebufferRenderbuffer (GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, _scaledRb[1]);
+	if (GL_FRAMEBUFFER_COMPLETE != glCheckFramebufferStatus (GL_FRAMEBUFFER)) {
+	    glBindFramebuffer (GL_FRAMEBUFFER, 0);
+	    _scaledDraw = false;
+	    _resScale = 100;
+	    return 0;
+	}
+	_scaledSz.w = _winfo.w;
+	_scaledSz.h = _winfo.h;
+    }
+    return _scaledFb;
+}
+
+/// Upscales the drawn part of _scaledFb into the window, leaving it bound for reading
+void CGLWindow::ResolveScaledFramebuffer (void) noexcept
+{
+    GLint sw = (_winfo.w*_resScale+99)/100, sh = (_winfo.h*_resScale+99)/100;
+    glBindFramebuffer (GL_READ_FRAMEBUFFER, _scaledFb);
+    glBindFramebuffer (GL_DRAW_FRAMEBUFFER, 0);
+    glScissor (0, 0, _winfo.w, _winfo.h);
+    glBlitFramebuffer (0, 0, sw, sh, 0, 0, _winfo.w, _winfo.h, GL_COLOR_BUFFER_BIT, GL_LINEAR);
+    glBindFramebuffer (GL_READ_FRAMEBUFFER, 0);
+}
+
+/// With rflag_DynamicResolution, the default framebuffer is drawn at a lower
+/// resolution when the render time exceeds the budget. Render time is mostly
+/// proportional to pixel count, so the scale follows the square root of the
+/// time ratio. It is only done without MSAA, which a blit can not scale.
+void CGLWindow::ScaleResolution (void) noexcept
+{
+    if (!(_winfo.rflags & WinInfo::rflag_DynamicResolution) || _winfo.aa != WinInfo::MSAA_OFF || !LastRenderTime())
+	return;
+    auto budget = LastFrameTime()/100*c_ResolutionBudget;
+    auto s = unsigned (_resScale*sqrtf (float(budget)/LastRenderTime()));
+    if (s > _resScale) {
+	if (s < _resScale+2u)
+	    return;	// Close enough, to not change every frame
+	s = min (s, _resScale+unsigned(c_ResolutionStep));	// Scaled up gradually, to not overshoot
+    }
+    s = min (max (s, unsigned(c_MinResolutionScale)), 100u);
+    if (s != _resScale)
+	DTRACE ("[%x] Resolution scaled to %u%%, render time %u of %u ns\n", IId(), s, LastRenderTime(), budget);
+    _resScale = s;
+}
+
+void CGLWindow::SaveFramebuffer (coord_t x, coord_t y, coord_t w, coord_t h, const char* filename, G::Texture::Format fmt, uint8_t quality, G::Texture::EncodeSpeed speed)
 {
     if (!w) {
 	x = _viewport.x;
@@ -380,19 +1036,112 @@ void CGLWindow::SaveFramebuffer (coord_t x, coord_t y, coord_t w, coord_t h, con
 	w = _viewport.w;
 	h = _viewport.h;
     }
-    DTRACE ("[%x] Save framebuffer %ux%u+%d+%d to \"%s\" fmt %u quality %u\n", IId(), w,h,x,y, filename, fmt, quality);
-    char tmpfilename[] = SAVEFB_TMPFILE;
-    {
-	CFile of;
-	if (CanPassFd())
-	    of.Open (filename, O_WRONLY| O_CREAT| O_TRUNC| O_CLOEXEC, 0600);
-	else
-	    of.Attach (mkstemps (tmpfilename, strlen(".jpg")));
-	CTexture::Save (of.Fd(), x, y, w, h, fmt, quality);
-	SaveFB (_curFb, filename, of);
+    DTRACE ("[%x] Save framebuffer %ux%u+%d+%d to \"%s\" fmt %u quality %u speed %u\n", IId(), w,h,x,y, filename, fmt, quality, speed);
+    FinishReadbacks (c_MaxReadbacks-1);	// Waits for the oldest if all are in use
+    SReadback r = { 0, nullptr, _curFb, dim_t(w), dim_t(h), fmt, quality, speed, filename, false };
+    if (_scaledDraw && _curFb == G::default_Framebuffer) {	// Read at window resolution, as drawn so far
+	ResolveScaledFramebuffer();
+	StartReadback (r, x, y);
+	glBindFramebuffer (GL_FRAMEBUFFER, _scaledFb);
+	SetViewportRect();
+    } else
+	StartReadback (r, x, y);
+}
+
+void CGLWindow::StartCapture (const char* filename, G::CaptureFmt fmt, uint16_t interval)
+{
+    if (!CanPassFd())	// The file is created on the server host
+	XError::emit ("capture is only available to local clients");
+    auto frametime = max (LastFrameTime(), 1u);
+    auto fps = max (1u, (1000000000u+frametime/2)/frametime);
+    DTRACE ("[%x] Capturing %hux%hu at %u/%hu fps to %s\n", IId(), _winfo.w, _winfo.h, fps, interval, filename);
+    _capture.reset();
+    _capture.reset (new CFrameCapture (filename, fmt, _winfo.w, _winfo.h, fps, interval));
+    _capture->Start();
+    _captureSkip = 0;
+}
+
+/// Frames read back before stopping are written, so the file is complete when this returns
+void CGLWindow::StopCapture (void)
+{
+    if (!_capture)
+	return;
+    FinishReadbacks (0);
+    _capture.reset();
+}
+
+void CGLWindow::CaptureFrame (void)
+{
+    if (++_captureSkip < _capture->Interval())
+	return;
+    _captureSkip = 0;
+    FinishReadbacks();
+    if (_readbacks.size() >= c_MaxReadbacks) {	// Never waits, to not slow down the client
+	DTRACE ("[%x] Capture readbacks busy, frame dropped\n", IId());
+	return;
+    }
+    glBindFramebuffer (GL_READ_FRAMEBUFFER, 0);
+    SReadback r = { 0, nullptr, G::default_Framebuffer, _capture->Width(), _capture->Height(), G::Texture::Format::GLTX, 0, G::Texture::EncodeSpeed::DEFAULT, string(), true };
+    StartReadback (r, 0, 0);
+}
+
+/// Reads into a pixel buffer, which does not wait for rendering to finish
+void CGLWindow::StartReadback (SReadback& r, coord_t x, coord_t y)
+{
+    auto w = r.w, h = r.h;
+    if (_freePbo.empty())
+	glGenBuffers (1, &r.pbo);
+    else {
+	r.pbo = _freePbo.back();
+	_freePbo.pop_back();
+    }
+    glBindBuffer (GL_PIXEL_PACK_BUFFER, r.pbo);
+    glBufferData (GL_PIXEL_PACK_BUFFER, w*3*h, nullptr, GL_STREAM_READ);
+    glReadPixels (x, y, w, h, G::Pixel::RGB, G::Pixel::UNSIGNED_BYTE, nullptr);
+    glBindBuffer (GL_PIXEL_PACK_BUFFER, 0);
+    r.fence = glFenceSync (GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    _readbacks.push_back (move(r));
+}
+
+/// Sends completed readbacks to be encoded, waiting for those beyond \p maxPending
+void CGLWindow::FinishReadbacks (unsigned maxPending)
+{
+    while (!_readbacks.empty()) {
+	auto& r = _readbacks.front();
+	if (_readbacks.size() <= maxPending && GL_TIMEOUT_EXPIRED == glClientWaitSync (r.fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0))
+	    break;
+	glDeleteSync (r.fence);
+	unique_ptr<CFramebufferSave> job;
+	GLubyte* pixels = nullptr;
+	auto sz = r.w*3u*r.h;
+	if (!r.capture) {
+	    DTRACE ("[%x] Readback of %s complete\n", IId(), r.filename.c_str());
+	    job.reset (new CFramebufferSave (Fd(), IId(), r.fbid, r.filename.c_str(), r.w, r.h, r.fmt, r.quality, r.speed, CanPassFd()));
+	    pixels = job->Pixels();
+	} else if (_capture && _capture->FrameSize() == sz) {	// Otherwise capture was stopped or restarted
+	    _captureBuf.resize (sz);
+	    pixels = &_captureBuf[0];
+	}
+	glBindBuffer (GL_PIXEL_PACK_BUFFER, r.pbo);
+	auto p = pixels ? glMapBufferRange (GL_PIXEL_PACK_BUFFER, 0, sz, GL_MAP_READ_BIT) : nullptr;	// Waits, if not yet complete
+	if (p) {
+	    memcpy (pixels, p, sz);
+	    glUnmapBuffer (GL_PIXEL_PACK_BUFFER);
+	}
+	glBindBuffer (GL_PIXEL_PACK_BUFFER, 0);
+	_freePbo.push_back (r.pbo);
+	auto filename = move(r.filename);
+	auto capture = r.capture;
+	_readbacks.erase (_readbacks.begin());
+	if (!pixels)
+	    continue;
+	else if (!p)
+	    throw XError ("failed to read framebuffer for %s", capture ? "capture" : filename.c_str());
+	else if (job)
+	    CGleris::Instance().WorkerPool().Post (job.release());
+	else if (!_capture->Post (_captureBuf))
+	    DTRACE ("[%x] Capture writer busy, frame dropped\n", IId());
     }
-    if (CanPassFd())
-	unlink (tmpfilename);
 }
 
 //}}}-------------------------------------------------------------------
@@ -411,7 +1160,7 @@ void CGLWindow::Text (coord_t x, coord_t y, const char* s)
     unsigned nChars = 0;
     for (auto i = utf8in(s); *i; ++i)
 	ws[nChars++] = *i;
-    struct { GLshort x,y,w,h,s,t; } v [nChars];
+    SSprite v [nChars];
     const auto& fi = f.Info();
     uint16_t prevc = 0;
     for (unsigned i = 0, lx = x; i < nChars; ++i) {
@@ -427,20 +1176,9 @@ void CGLWindow::Text (coord_t x, coord_t y, const char* s)
 	v[i].x = lx + gi.bx;
 	lx += fi.Width (c);
     }
-    GLuint buf;
-    glGenBuffers (1, &buf);
-    glBindBuffer (GL_ARRAY_BUFFER, buf);
-    glBufferData (GL_ARRAY_BUFFER, sizeof(v), v, GL_STREAM_DRAW);
-    glEnableVertexAttribArray (G::param_Vertex);
-    glEnableVertexAttribArray (G::param_TexCoord);
-    glVertexAttribPointer (G::param_Vertex, 4, GL_SHORT, GL_FALSE, sizeof(v[0]), 0);
-    glVertexAttribPointer (G::param_TexCoord, 2, GL_SHORT, GL_FALSE, sizeof(v[0]), (GLvoid*)(4*sizeof(GLshort)));
     UniformTexture ("Texture", f);
     Uniform4f ("FontTextureSize", f.TextureInfo().w, f.TextureInfo().h, f.TextureInfo().w, f.TextureInfo().h);
-    glDrawArrays (GL_POINTS, 0, nChars);
-    glDisableVertexAttribArray (G::param_Vertex);
-    glDisableVertexAttribArray (G::param_TexCoord);
-    glDeleteBuffers (1, &buf);
+    DrawQuads (v, nChars);
 }
 
 //}}}-------------------------------------------------------------------
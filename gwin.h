@@ -5,6 +5,8 @@
 
 #pragma once
 #include "iconn.h"
+#include "rthread.h"
+#include "capture.h"
 
 class CGLWindow : public PRGLR {
 private:
@@ -17,16 +19,59 @@ private:
     enum {
 	NotWaitingForVSync = CApp::NoTimer,
 	c_DefaultFrameTimeNS = 1000000000/60,
-	c_MaxFrameTimeNS = 1000000000/1
+	c_MaxFrameTimeNS = 1000000000/1,
+	c_SubmitMarginNS = 2000000	///< Allowance for sending and parsing the client's drawlist
+    };
+    enum {	// Dynamic resolution, in percent
+	c_MinResolutionScale = 50,
+	c_ResolutionBudget = 85,	///< Of the refresh interval, for render time
+	c_ResolutionStep = 5		///< Largest increase per frame
     };
     enum { MAX_VAO_SLOTS = 16 };
+    enum { c_DrawOffsetSlot = MAX_VAO_SLOTS-2, c_DrawColorSlot };	///< Attributes of merge_v.glsl
+    enum { c_MaxReadbacks = 4 };
+    enum { c_MaxDamageAge = 4 };	///< Oldest back buffer that damage can be used with
+    enum { c_DrawStateBufSize = 64*1024 };
+    struct SDamage {
+	int			x1,y1,x2,y2;	///< In window pixels, top-left origin, x2,y2 exclusive
+	inline bool		empty (void) const	{ return x1 >= x2 || y1 >= y2; }
+	inline void		Add (const SDamage& d)	{ if (empty()) *this = d; else if (!d.empty()) { x1 = min(x1,d.x1); y1 = min(y1,d.y1); x2 = max(x2,d.x2); y2 = max(y2,d.y2); } }
+    };
+    struct SSprite {		///< Vertex of the texture and font shaders, expanded to a quad
+	GLshort			x,y,w,h,s,t;
+    };
+    struct SDrawArraysCmd {	///< Of glMultiDrawArraysIndirect
+	GLuint			count, instanceCount, first, baseInstance;
+    };
+    struct SDrawAttrs {		///< Per-draw attributes of merged draws, selected by baseInstance
+	GLfloat			x,y;
+	GLfloat			r,g,b,a;
+    };
+    struct SDrawState {		///< The std140 DrawState uniform block of the built-in shaders
+	GLfloat			transform [16];
+	GLfloat			color [4];
+	GLfloat			viewport [4];
+    };
+    struct SReadback {
+	GLuint			pbo;
+	GLsync			fence;
+	goid_t			fbid;
+	dim_t			w,h;
+	G::Texture::Format	fmt;
+	uint8_t			quality;
+	G::Texture::EncodeSpeed	speed;
+	string			filename;
+	bool			capture;	///< A frame for _capture rather than a SaveFramebuffer
+    };
     using matrix4f_t		= float[4][4];
     using WinInfo		= PRGL::WinInfo;
     using rangevec_t		= PDraw<bstri>::rangevec_t;
+    using SpriteRect		= PDraw<bstri>::SpriteRect;
 public:
+    enum { c_ReadbackPollMS = 2, c_FramePollMS = 1, c_HiddenFrameMS = 100 };
 				CGLWindow (iid_t iid, const WinInfo& winfo, Window win, GLXContext ctx, CIConn* pconn);
 				~CGLWindow (void) noexcept;
-    void			Init (void);
+    void			Init (Display* dpy);
     void			Activate (void);
     void			Deactivate (void);
     inline const CContext&	Context (void) const		{ return _ctx; }
@@ -38,11 +83,34 @@ public:
     inline const CTexture::CParam& TexParams (void) const	{ return _texparam; }
     void			Resize (coord_t x, coord_t y, dim_t w, dim_t h) noexcept;
     void			ParseDrawlist (goid_t fbid, bstri cmdis);
-    uint64_t			DrawFrame (bstri cmdis, Display* dpy);
-    uint64_t			DrawFrameNoWait (bstri cmdis, Display* dpy);
-    uint64_t			DrawPendingFrame (Display* dpy);
+    using seq_t			= CDrawlist::seq_t;
+    inline seq_t		ReceiveFrame (void)		{ if (!++_frameSeq) ++_frameSeq; return _frameSeq; }
+    uint64_t			DrawFrame (CDrawlist& f, Display* dpy);
+    bool			RenderFrame (CDrawlist& f, Display* dpy);
+    bool			RenderFrame (bstri cmdis, seq_t seq, Display* dpy);
+    void			SwapFrame (Display* dpy);
+    bool			RenderPendingFrame (Display* dpy);
+    inline bool			FrameDue (uint64_t tms) const	{ return _nextVSync == NotWaitingForVSync ? _pendingFrame.Seq() || _redrawReq : _nextVSync <= tms; }
+				/// The last frame is kept to redraw on Expose, until resized or resources change
+    inline bool			CanRedraw (void) const		{ auto g = __atomic_load_n (&_lastFrameGen, __ATOMIC_RELAXED); return g && g == _pconn->Generation(); }
+    inline void			RequestRedraw (void)		{ __atomic_store_n (&_redrawReq, true, __ATOMIC_RELAXED); }
+    bool			PollFrame (Display* dpy);
+    uint64_t			SwapComplete (int64_t ust, int64_t sbc) noexcept;
     inline void			ClearPendingFrame (void)	{ _pendingFrame.clear(); }
+    void			SetPendingFrame (const bstri& cmdis, CRecvBuf* src, seq_t seq);
+    inline void			TakePendingFrame (CDrawlist& f)	{ f.swap (_pendingFrame); _pendingFrame.clear(); }
+    void			RestorePendingFrame (CDrawlist& f);
+				// Render thread, when drawing is not done on the main thread
+    void			StartRenderThread (Display* dpy, CRenderResults& results);
+    inline void			StopRenderThread (void) noexcept	{ if (_rthread) _rthread->Stop(); }
+    inline bool			HasRenderThread (void) const	{ return _rthread && _rthread->Running(); }
+    inline CRenderThread&	RenderThread (void)		{ return *_rthread; }
     uint64_t			NextFrameTime (void) const	{ return _nextVSync; }
+    void			SetPresentMode (Display* dpy, G::PresentMode m);
+    inline G::PresentMode	PresentMode (void) const	{ return _presentMode; }
+				/// Frames of hidden windows are not drawn; set from the main thread, read on the render thread
+    inline bool			Hidden (void) const		{ return __atomic_load_n (&_hidden, __ATOMIC_RELAXED); }
+    inline void			SetHidden (bool h)		{ __atomic_store_n (&_hidden, h, __ATOMIC_RELAXED); }
     void			CheckForErrors (void);
 				// Client-side id map, forwarded to the connection object
     inline void			VerifyFreeId (goid_t cid) const	{ return _pconn->VerifyFreeId (cid); }
@@ -58,6 +126,8 @@ public:
 				    { _pconn->FreeResource (id, dtype); _pendingFrame.clear(); }
     inline void			FreeResources (void)
 				    { _pconn->FreeResources (this); }
+    inline bool			MustWaitForLoads (void) const	{ return _pconn->MustWaitForLoads (this); }
+    inline void			EndLoad (CTextureLoad* l)	{ _pconn->EndLoad (l); }
 				// Datapak
     inline const CDatapak&	LookupDatapak (goid_t id) const	{ return _pconn->LookupDatapak (id); }
 				// Buffer
@@ -65,6 +135,7 @@ public:
     inline const CBuffer&	LookupBuffer (goid_t id) const	{ return _pconn->LookupBuffer (id); }
     void			BufferSubData (const CBuffer& buf, const void* data, GLuint dsz, GLuint offset) const noexcept {
 				    DTRACE ("[%x] BufferSubData %u bytes at %u into %x\n", IId(), dsz, offset, buf.Id());
+				    _pconn->Changed();
 				    glBindBuffer (buf.Type(), buf.Id());
 				    glBufferSubData (buf.Type(), offset, dsz, data);
 				}
@@ -90,27 +161,37 @@ public:
     void			Uniform4iv (const char* varname, const GLint* v) const noexcept;
     void			UniformMatrix (const char* varname, const GLfloat* mat) const noexcept;
     void			UniformTexture (const char* varname, const CTexture& tex, GLuint itex = 0) noexcept;
+    void			UniformBuffer (const char* block, GLuint binding, const CBuffer& buf, GLuint offset, GLuint size) noexcept;
     void			Color (GLuint c) noexcept;
     inline void			Color (GLubyte r, GLubyte g, GLubyte b, GLubyte a =255)	{ Color (RGBA(r,g,b,a)); }
     void			Clear (GLuint c) noexcept;
     void			Viewport (GLint x, GLint y, GLsizei w, GLsizei h) noexcept;
     void			Offset (GLint x, GLint y) noexcept;
+    void			Damage (coord_t x, coord_t y, dim_t w, dim_t h) noexcept;
+    void			AnimateColor (GLuint c1, GLuint c2, uint32_t periodms, G::Animation a) noexcept;
+    void			AnimateOffset (coord_t x1, coord_t y1, coord_t x2, coord_t y2, uint32_t periodms, G::Animation a) noexcept;
+    void			AnimateUniform (const char* varname, const GLfloat* v1, const GLfloat* v2, uint32_t periodms, G::Animation a) noexcept;
     void			Scale (float x, float y) noexcept;
     void			Enable (G::Feature f, uint16_t o) noexcept;
 				//{{{ DrawArrays and friends, inlined
     void			DrawCmdInit (void) noexcept;
-    void			DrawArrays (G::Shape mode, GLuint first, GLuint count) noexcept {
+    void			DrawArrays (G::Shape mode, GLuint first, GLuint count) {
 				    DTRACE ("[%x] DrawArrays %s: %u vertices from %u\n", IId(), G::ShapeName(mode), count, first);
 				    if (!count)
 					return;
+				    if (MergingDraws())
+					return QueueDraw (mode, first, count);
+				    UploadDrawState();
 				    glDrawArrays (mode,first,count);
 				}
     void			DrawArraysIndirect (G::Shape type, uint32_t offset = 0) noexcept {
 				    DTRACE ("[%x] DrawArraysIndirect %s: offset %u\n", IId(), G::ShapeName(type), offset);
+				    UploadDrawState();
 				    glDrawArraysIndirect (type, BufferOffset(offset));
 				}
     void			DrawArraysInstanced (G::Shape type, uint32_t start, uint32_t sz, uint32_t nInstances, uint32_t baseInstance = 0) noexcept {
 				    DTRACE ("[%x] DrawArraysInstanced %s: %u vertices from %u, %u instances, base %u\n", IId(), G::ShapeName(type), sz, start, nInstances, baseInstance);
+				    UploadDrawState();
 				    if (!sz || !nInstances)
 					return;
 				    if (baseInstance)
@@ -120,6 +201,7 @@ public:
 				}
     void			DrawElements (G::Shape type, uint16_t n, G::Type itype = G::UNSIGNED_SHORT, uint32_t offset = 0, uint32_t baseVertex = 0) noexcept {
 				    DTRACE ("[%x] DrawElements %s: %u indexes from %u, basevertex %u, type %s\n", IId(), G::ShapeName(type), n, offset, baseVertex, G::TypeName(itype));
+				    UploadDrawState();
 				    if (!n)
 					return;
 				    if (baseVertex)
@@ -129,10 +211,12 @@ public:
 				}
     void			DrawElementsIndirect (G::Shape type, G::Type itype = G::UNSIGNED_SHORT, uint16_t offset = 0) noexcept {
 				    DTRACE ("[%x] DrawElementsIndirect %s: offset %u\n", IId(), G::ShapeName(type), offset);
+				    UploadDrawState();
 				    glDrawElementsIndirect (type, itype, BufferOffset(offset));
 				}
     void			DrawElementsInstanced (G::Shape type, uint16_t n, uint32_t nInstances, G::Type itype = G::UNSIGNED_SHORT, uint32_t offset = 0, uint32_t baseVertex = 0, uint32_t baseInstance = 0) noexcept {
 				    DTRACE ("[%x] DrawElementsInstanced %s: %u indexes from %u, basevertex %u, %u instances, base %u\n", IId(), G::ShapeName(type), n, offset, baseVertex, nInstances, baseInstance);
+				    UploadDrawState();
 				    if (!n || !nInstances)
 					return;
 				    if (baseVertex && baseInstance)
@@ -146,6 +230,7 @@ public:
 				}
     void			DrawRangeElements (G::Shape type, uint16_t minel, uint16_t maxel, uint16_t n, G::Type itype = G::UNSIGNED_SHORT, uint32_t offset = 0, uint32_t baseVertex = 0) noexcept {
 				    DTRACE ("[%x] DrawRangeElements %s: %u vertices from %u, basevertex %u, range %hu-%hu, type %s\n", IId(), G::ShapeName(type), n, offset, baseVertex, minel, maxel, G::TypeName(itype));
+				    UploadDrawState();
 				    if (!n)
 					return;
 				    if (baseVertex)
@@ -155,6 +240,7 @@ public:
 				}
     void			MultiDrawArrays (G::Shape mode, const rangevec_t& r) {
 				    DTRACE ("[%x] MultiDrawArrays %s: %u primitives\n", IId(), G::ShapeName(mode), (unsigned) r.size());
+				    UploadDrawState();
 				    if (r.empty())
 					return;
 				    vector<GLint> first; vector<GLsizei> count;
@@ -167,12 +253,14 @@ public:
 				}
     void			MultiDrawArraysIndirect (G::Shape type, uint32_t n, uint32_t stride = 0, uint32_t offset = 0) noexcept {
 				    DTRACE ("[%x] MultiDrawArraysIndirect %s: %u primitives, offset %u, stride %u\n", IId(), G::ShapeName(type), n, offset, stride);
+				    UploadDrawState();
 				    if (!n)
 					return;
 				    glMultiDrawArraysIndirect (type, BufferOffset(offset), n, stride);
 				}
     void			MultiDrawElements (G::Shape type, const rangevec_t& r, G::Type itype = G::UNSIGNED_SHORT) noexcept {
 				    DTRACE ("[%x] MultiDrawElements %s: %u primitives of type %s\n", IId(), G::ShapeName(type), (unsigned) r.size(), G::TypeName(itype));
+				    UploadDrawState();
 				    if (r.empty())
 					return;
 				    vector<const GLvoid*> first; vector<GLsizei> count;
@@ -185,6 +273,7 @@ public:
 				}
     void			MultiDrawElementsIndirect (G::Shape type, G::Type itype, uint32_t n, uint16_t stride = 0, uint32_t offset = 0) noexcept {
 				    DTRACE ("[%x] MultiDrawElementsIndirect %s: %u primitives of type %s, offset %u, stride %hu\n", IId(), G::ShapeName(type), n, G::TypeName(itype), offset, stride);
+				    UploadDrawState();
 				    glMultiDrawElementsIndirect (type, itype, BufferOffset(offset), n, stride);
 				}
 				//}}}
@@ -193,11 +282,21 @@ public:
     inline void			TexParameter (G::TextureType t, G::Texture::Parameter p, int v)	{ _texparam.Set(t,p,v); }
     void			Sprite (const CTexture& t, coord_t x, coord_t y);
     void			Sprite (const CTexture& t, coord_t x, coord_t y, coord_t sx, coord_t sy, dim_t sw, dim_t sh);
+    void			Sprites (const CTexture& t, const SpriteRect* r, uint32_t n);
+    void			FlushSprites (void);
+    void			FlushDraws (void);
+				// Vertex array
+    inline const CVertexArray&	LookupVertexArray (goid_t id) const	{ return _pconn->LookupVertexArray (id); }
+    void			BindVertexArray (goid_t id);
 				// Framebuffer
     inline const CFramebuffer&	LookupFramebuffer (goid_t id) const	{ return _pconn->LookupFramebuffer (id); }
     void			BindFramebuffer (const CFramebuffer& fb, G::FramebufferType bindas);
     void			BindFramebufferComponent (const CFramebuffer& fb, const G::FramebufferComponent& c) { fb.Attach (c, LookupTexture (c.texture)); }
-    void			SaveFramebuffer (coord_t x, coord_t y, coord_t w, coord_t h, const char* filename, G::Texture::Format fmt, uint8_t quality);
+    void			SaveFramebuffer (coord_t x, coord_t y, coord_t w, coord_t h, const char* filename, G::Texture::Format fmt, uint8_t quality, G::Texture::EncodeSpeed speed);
+    inline bool			ReadbacksPending (void) const	{ return !_readbacks.empty(); }
+    void			FinishReadbacks (unsigned maxPending = c_MaxReadbacks);
+    void			StartCapture (const char* filename, G::CaptureFmt fmt, uint16_t interval);
+    void			StopCapture (void);
 				// Font
     inline const CFont&		LookupFont (goid_t id) const	{ return _pconn->LookupFont (id); }
     void			Text (coord_t x, coord_t y, const char* s);
@@ -206,6 +305,28 @@ private:
     inline void			SetDefaultShader (void)noexcept	{ Shader (_pconn->DefaultShader()); }
     inline void			SetTextureShader (void)noexcept	{ Shader (_pconn->TextureShader()); }
     inline void			SetFontShader (void) noexcept	{ Shader (_pconn->FontShader()); }
+    void			StreamVertices (const void* v, GLsizeiptr vsz) noexcept;
+    void			DrawQuads (const SSprite* v, GLsizei n) noexcept;
+    void			TransformChanged (void) noexcept;
+    inline bool			MergingDraws (void) const	{ return (_winfo.rflags & WinInfo::rflag_MergeDraws) && _winfo.maxgl >= 0x43 && Shader() == G::default_FlatShader && _clientVao == _vao[0]; }
+    void			QueueDraw (G::Shape mode, GLuint first, GLuint count);
+    void			UploadDrawState (void) noexcept;
+    void			PostSyncEvent (void);
+    void			FinishFrame (void);
+    void			DropFrame (seq_t seq);
+    void			SetSubmitDelay (unsigned ms) noexcept;
+    void			PaceNextFrame (void) noexcept;
+    void			StartReadback (SReadback& r, coord_t x, coord_t y);
+    void			CaptureFrame (void);
+    void			ScaleResolution (void) noexcept;
+    GLuint			ScaledFramebuffer (void);
+    void			ResolveScaledFramebuffer (void) noexcept;
+    void			SetViewportRect (void) noexcept;
+    void			BeginDamage (Display* dpy) noexcept;
+    void			EndDamage (seq_t seq) noexcept;
+    bool			SameAsLastFrame (const bstri& cmdis) const noexcept;
+    float			AnimationPhase (uint32_t periodms, G::Animation a) noexcept;
+    inline void			ResetDamage (void) noexcept	{ for (auto& d : _pastDamage) d = SDamage { 0, 0, INT16_MAX, INT16_MAX }; _damageCopied = false; }
 				// State variables
     inline const float*		Proj (void) const		{ return &_proj[0][0]; }
     inline GLuint		Color (void) const		{ return _color; }
@@ -224,15 +345,62 @@ private:
     inline bool			QueryResultAvailable (GLuint q) const;
 private:
     CContext			_ctx;
-    vector<GLubyte>		_pendingFrame;
+    CDrawlist			_pendingFrame;
+    CDrawlist			_lastFrame;	///< Last frame drawn, or skipped while hidden
+    vector<SSprite>		_sprites;	///< Consecutive sprites of _spriteTex, drawn together
+    const CTexture*		_spriteTex;
+    vector<SDrawArraysCmd>	_drawCmds;	///< Consecutive flat shader draws, differing only in offset and color
+    vector<SDrawAttrs>		_drawAttrs;	///< Parallel to _drawCmds
+    G::Shape			_drawMode;	///< Of _drawCmds
+    vector<SReadback>		_readbacks;	///< SaveFramebuffer requests waiting for the GPU
+    vector<GLuint>		_freePbo;	///< Pixel buffers of finished readbacks, for reuse
+    unique_ptr<CFrameCapture>	_capture;
+    CFrameCapture::framebuf_t	_captureBuf;
+    unsigned			_captureSkip;	///< Frames since the last captured one
+    unique_ptr<CRenderThread>	_rthread;
     CIConn*			_pconn;
     matrix4f_t			_proj;
     GLuint			_color;
     GLuint			_query[NStdQueries];
-    GLuint			_vao[2];
+    GLuint			_vao[3];	///< For the client, the font shader, and the texture shader
+    GLuint			_clientVao;	///< Bound with client shaders; _vao[0] or a CVertexArray
+    GLuint			_streamBuf;	///< Vertices generated by the server each draw
+    GLuint			_indirectBuf;	///< _drawCmds of the last merged draw
+    GLuint			_drawStateBuf;	///< SDrawState ring, orphaned when full
+    GLuint			_drawStateOffset;	///< Of the next SDrawState in _drawStateBuf
+    GLuint			_drawStateStep;	///< sizeof(SDrawState) aligned to GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT
+    bool			_drawStateChanged;	///< Since the last UploadDrawState
+    GLint			_transformSlot;	///< Plain uniforms of the current shader, if it has no DrawState block
+    GLint			_colorSlot;
     CEvent			_syncEvent;
     uint64_t			_nextVSync;
     uint64_t			_lastVSync;
+    GLsync			_frameFence;	///< Signaled when the last swapped frame is done
+    int64_t			_swapSbc;	///< Swap buffer count of the last frame, with OML_sync_control
+    uint64_t			_presentUST;	///< Present time of the last frame, in us, if known
+    uint64_t			_lastPresentUST;
+    uint32_t			_droppedFrames;
+    seq_t			_frameSeq;	///< Of the last frame received
+    seq_t			_swapSeq;	///< Of the frame in flight
+    G::PresentMode		_presentMode;
+    bool			_hidden;	///< Fully obscured or unmapped
+    GLuint			_scaledFb;	///< With rflag_DynamicResolution, the default framebuffer is drawn here
+    GLuint			_scaledRb[2];	///< Color and depth attachments of _scaledFb, window-sized
+    struct { dim_t w,h; }	_scaledSz;
+    uint8_t			_resScale;	///< Percent of window resolution the default framebuffer is drawn at
+    bool			_scaledDraw;	///< Drawing to _scaledFb
+    uint8_t			_bufferAge;	///< Of the back buffer drawn, in frames, if damage can be used
+    SDamage			_damage;	///< Declared for the frame being drawn
+    SDamage			_pastDamage [c_MaxDamageAge-1];	///< Of the previous frames, newest first
+    SDamage			_copyDamage;	///< To present by copying to the front buffer instead of swapping
+    bool			_damageCopied;	///< The last frame was presented with _copyDamage, so the back buffer still has it
+    uint32_t			_lastFrameGen;	///< Resource generation of _lastFrame, or 0 if it can not be redrawn
+    bool			_lastFrameDrawn;	///< As opposed to skipped while hidden
+    bool			_redrawReq;	///< Redraw _lastFrame on Expose
+    bool			_animating;	///< _lastFrame has running animations and is redrawn every vsync
+    uint64_t			_animEpoch;	///< Repeating animations are timed from window creation
+    uint64_t			_animStart;	///< ONCE animations are timed from when the drawlist was first drawn
+    uint64_t			_animTime;	///< Expected present time of the frame being drawn
     GLuint			_curShaderId;
     goid_t			_curShader;
     goid_t			_curBuffer;
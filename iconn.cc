@@ -4,15 +4,17 @@
 // This file is free software, distributed under the MIT License.
 
 #include "iconn.h"
-#include "gwin.h"
+#include "gleris.h"
 #include ".o/data/data.h"
 
 const CGLWindow* CIConn::_shwin = nullptr;
 const CIConn* CIConn::_shconn = nullptr;
+bool CIConn::_instancedQuads = false;
 
 CIConn::CIConn (iid_t iid, int fd, bool fdpass)
 : CCmdBuf(iid,fd,fdpass)
 ,_obj()
+,_loads()
 ,_argv()
 ,_hostname()
 ,_pid(0)
@@ -23,6 +25,8 @@ CIConn::CIConn (iid_t iid, int fd, bool fdpass)
 
 CIConn::~CIConn (void) noexcept
 {
+    for (auto l : _loads)
+	CancelLoad (l);
     for (auto o : _obj) {
 	DTRACE ("Deleting object cid %x, sid %x\n", o->CId(), o->Id());
 	delete o;
@@ -63,8 +67,25 @@ void CIConn::LoadDefaultResources (CGLWindow* w)
     const auto& pak = LoadDatapak (w, G::default_ResourcePak, ArrayBlock (File_resource));
     LoadShader (w, G::default_FlatShader, pak, "sh/flat_v.glsl", "sh/flat_f.glsl");
     LoadShader (w, G::default_GradientShader, pak, "sh/grad_v.glsl", "sh/grad_f.glsl");
-    LoadShader (w, G::default_TextureShader, pak, "sh/image_v.glsl", "sh/image_g.glsl", "sh/image_f.glsl");
-    LoadShader (w, G::default_FontShader, pak, "sh/font_v.glsl", "sh/image_g.glsl", "sh/font_f.glsl");
+    LoadShader (w, G::default_MergedDrawShader, pak, "sh/merge_v.glsl", "sh/grad_f.glsl");
+    // Geometry shaders are slow on many drivers, so instanced quads are used where they build.
+    // GLERI_GEOMETRY_QUADS selects the geometry shaders anyway, for testing and comparison.
+    _instancedQuads = !getenv ("GLERI_GEOMETRY_QUADS");
+    if (_instancedQuads) {
+	try {
+	    LoadShader (w, G::default_TextureShader, pak, "sh/image_iv.glsl", "sh/image_f.glsl");
+	    LoadShader (w, G::default_FontShader, pak, "sh/font_iv.glsl", "sh/font_f.glsl");
+	} catch (XError& e) {
+	    DTRACE ("Instanced quad shaders not available: %s\n", e.what());
+	    if (FindObject (G::default_TextureShader))
+		FreeResource (G::default_TextureShader, PRGL::EResource::SHADER);
+	    _instancedQuads = false;
+	}
+    }
+    if (!_instancedQuads) {
+	LoadShader (w, G::default_TextureShader, pak, "sh/image_v.glsl", "sh/image_g.glsl", "sh/image_f.glsl");
+	LoadShader (w, G::default_FontShader, pak, "sh/font_v.glsl", "sh/image_g.glsl", "sh/font_f.glsl");
+    }
     LoadPakResource (w, G::default_Font, PRGL::EResource::FONT, 0, pak, "ter-d18b.psf", strlen("ter-d18b.psf"));
     FreeResource (G::default_ResourcePak, PRGL::EResource::DATAPAK);
     _shwin = w;
@@ -94,6 +115,8 @@ void CIConn::LoadResource (CGLWindow* w, goid_t id, PRGL::EResource dtype, uint1
 	LoadTexture (w, id, d, dsz, G::Pixel::Fmt(hint), PRGL::TextureTypeFromResource(dtype));
     else if (dtype == PRGL::EResource::FRAMEBUFFER)
 	LoadFramebuffer (w, id, d, dsz);
+    else if (dtype == PRGL::EResource::VERTEX_ARRAY)
+	LoadVertexArray (w, id, d, dsz);
     else if (dtype == PRGL::EResource::FONT)
 	LoadFont (w, id, d, dsz, hint);
     else if (dtype == PRGL::EResource::SHADER) {
@@ -121,6 +144,13 @@ void CIConn::LoadPakResource (CGLWindow* w, goid_t id, PRGL::EResource dtype, ui
 void CIConn::FreeResource (goid_t cid, PRGL::EResource)
 {
     DTRACE ("[fd %d] FreeResource %x\n", Fd(), cid);
+    Changed();
+    for (auto l = _loads.begin(); l < _loads.end(); ++l) {
+	if ((*l)->CId() == cid) {
+	    CancelLoad (*l);
+	    --(l = _loads.erase(l));
+	}
+    }
     auto io = lower_bound (_obj.begin(), _obj.end(), cid, [](const CGObject* o, goid_t id) { return o->CId() < id; });
     if (io != _obj.end() && (*io)->CId() == cid) {
 	DTRACE ("[fd %d] Deleting object %x, sid %x\n", Fd(), (*io)->CId(), (*io)->Id());
@@ -132,6 +162,13 @@ void CIConn::FreeResource (goid_t cid, PRGL::EResource)
 void CIConn::FreeResources (const CGLWindow* w)
 {
     DTRACE ("[%x] Freeing all resources in context %x\n", w->IId(), w->ContextId());
+    Changed();
+    for (auto l = _loads.begin(); l < _loads.end(); ++l) {
+	if ((*l)->Window() == w) {
+	    CancelLoad (*l);
+	    --(l = _loads.erase(l));
+	}
+    }
     for (auto r = _obj.begin(); r < _obj.end(); ++r) {
 	if ((*r)->Context() == w->ContextId()) {
 	    DTRACE ("[%x] Deleting object %x, sid %x\n", w->IId(), (*r)->CId(), (*r)->Id());
@@ -141,6 +178,37 @@ void CIConn::FreeResources (const CGLWindow* w)
     }
 }
 
+bool CIConn::MustWaitForLoads (const CGLWindow* w) const noexcept
+{
+    for (auto l : _loads)
+	if (l->Window() == w && l->MustWait())
+	    return true;
+    return false;
+}
+
+void CIConn::EndLoad (CTextureLoad* l) noexcept
+{
+    Changed();	// The texture now has the decoded image
+    auto il = find (_loads.begin(), _loads.end(), l);
+    if (il != _loads.end())
+	_loads.erase (il);
+}
+
+/// Uploads the next slice of the first sliced texture upload. Returns
+/// true if there are more slices to upload.
+bool CIConn::UploadSlices (void) noexcept
+{
+    auto il = find_if (_loads.begin(), _loads.end(), [](const CTextureLoad* l) { return l->Uploading(); });
+    if (il == _loads.end())
+	return false;
+    if ((*il)->UploadSlice()) {
+	delete *il;
+	_loads.erase (il);
+	Changed();
+    }
+    return any_of (_loads.begin(), _loads.end(), [](const CTextureLoad* l) { return l->Uploading(); });
+}
+
 //----------------------------------------------------------------------
 
 const CDatapak& CIConn::LoadDatapak (CGLWindow* w, goid_t cid, const GLubyte* pi, GLuint isz)
@@ -179,7 +247,17 @@ void CIConn::LoadShader (CGLWindow* w, goid_t cid, const CDatapak& pak, const ch
 void CIConn::LoadTexture (CGLWindow* w, goid_t cid, const GLubyte* d, GLuint dsz, G::Pixel::Fmt storeas, G::TextureType ttype)
 {
     DTRACE ("[%x] LoadTexture %x type %u from %u bytes\n", w->IId(), cid, ttype, dsz);
-    auto t = new CTexture (w->ContextId(), cid, d, dsz, storeas, ttype, w->TexParams());
+    auto& param = w->TexParams();
+    if (ttype == G::TEXTURE_2D && param.Get (ttype, G::Texture::LOAD_MODE) != G::Texture::LOAD_SYNC && CTexture::IsEncodedImage (d, dsz)) {
+	// Image decoding is slow, so is done on a worker thread into a blank texture
+	auto t = new CTexture (w->ContextId(), cid, ttype, param);
+	AddObject (unique_ptr<CGObject>(t));
+	auto l = new CTextureLoad (w, t, d, dsz, storeas, ttype, param);
+	_loads.push_back (l);
+	CGleris::Instance().WorkerPool().Post (l);
+	return;
+    }
+    auto t = new CTexture (w->ContextId(), cid, d, dsz, storeas, ttype, param);
     AddObject (unique_ptr<CGObject>(t));
     w->ResourceInfo (cid, uint16_t(PRGL::ResourceFromTextureType(ttype)), t->Info());
 }
@@ -190,6 +268,12 @@ void CIConn::LoadFramebuffer (CGLWindow* w, goid_t cid, const GLubyte* d, GLuint
     AddObject (unique_ptr<CGObject>(new CFramebuffer (w->ContextId(), cid, d, dsz, *this)));
 }
 
+void CIConn::LoadVertexArray (CGLWindow* w, goid_t cid, const GLubyte* d, GLuint dsz)
+{
+    DTRACE ("[%x] LoadVertexArray %x from %u bytes\n", w->IId(), cid, dsz);
+    AddObject (unique_ptr<CGObject>(new CVertexArray (w->ContextId(), cid, d, dsz, *this)));
+}
+
 void CIConn::LoadFont (CGLWindow* w, goid_t cid, const GLubyte* p, GLuint psz, uint8_t fontSize)
 {
     DTRACE ("[%x] LoadFont %x from %u bytes, varsize %hhu\n", w->IId(), cid, psz, fontSize);
@@ -8,6 +8,7 @@
 #include "gleri.h"
 #include "goshad.h"
 #include "gofont.h"
+#include "texload.h"
 
 class CGLWindow;
 
@@ -31,27 +32,39 @@ public:
     inline void			SetPid (uint32_t pid)		{ _pid = pid; }
     inline uint32_t		Screen (void) const		{ return _screen; }
     inline void			SetScreen (uint32_t screen)	{ _screen = screen; }
+				/// Changed with any resource, for windows to know if their last frame would still look the same
+    inline uint32_t		Generation (void) const		{ return __atomic_load_n (&_gen, __ATOMIC_RELAXED); }
+    inline void			Changed (void) noexcept		{ if (!__atomic_add_fetch (&_gen, 1, __ATOMIC_RELAXED)) __atomic_add_fetch (&_gen, 1, __ATOMIC_RELAXED); }	// 0 is not a generation
 				// Shared resources
     void			LoadDefaultResources (CGLWindow* w);
     inline static bool		HaveDefaultResources (void)	{ return _shwin; }
+				/// The texture and font shaders draw instanced quads instead of expanding points in a geometry shader
+    inline static bool		InstancedQuads (void)		{ return _instancedQuads; }
     const CShader&		DefaultShader (void) const	{ return _shconn->LookupShader(G::default_FlatShader); }
     const CShader&		GradientShader (void) const	{ return _shconn->LookupShader(G::default_GradientShader); }
     const CShader&		TextureShader (void) const	{ return _shconn->LookupShader(G::default_TextureShader); }
     const CShader&		FontShader (void) const		{ return _shconn->LookupShader(G::default_FontShader); }
+    const CShader&		MergedDrawShader (void) const	{ return _shconn->LookupShader(G::default_MergedDrawShader); }
     const CFont&		DefaultFont (void) const	{ return _shconn->LookupFont(G::default_Font); }
 				// Resource loader by enum
     void			LoadResource (CGLWindow* w, goid_t id, PRGL::EResource dtype, uint16_t hint, const GLubyte* d, GLuint dsz);
     void			LoadPakResource (CGLWindow* w, goid_t id, PRGL::EResource dtype, uint16_t hint, const CDatapak& pak, const char* filename, GLuint flnsz);
     void			FreeResource (goid_t id, PRGL::EResource dtype);
     void			FreeResources (const CGLWindow* w);
+				// Textures decoded in the background
+    bool			MustWaitForLoads (const CGLWindow* w) const noexcept;
+    void			EndLoad (CTextureLoad* l) noexcept;
+    bool			UploadSlices (void) noexcept;
 				// Lookups for all resources
     const CDatapak&		LookupDatapak (goid_t id) const	{ return LookupObject<CDatapak> (id, "no datapak %x"); }
     const CBuffer&		LookupBuffer (goid_t id) const	{ return LookupObject<CBuffer> (id, "no buffer %x"); }
     const CShader&		LookupShader (goid_t id) const	{ return LookupObject<CShader> (id, "no shader %x"); }
     const CTexture&		LookupTexture (goid_t id) const	{ return LookupObject<CTexture> (id, "no texture %x"); }
     const CFramebuffer&		LookupFramebuffer (goid_t id) const { return LookupObject<CFramebuffer> (id, "no framebuffer %x"); }
+    const CVertexArray&		LookupVertexArray (goid_t id) const { return LookupObject<CVertexArray> (id, "no vertex array %x"); }
     const CFont&		LookupFont (goid_t id) const	{ return LookupObject<CFont> (id, "no font %x"); }
 private:
+    static inline void		CancelLoad (CTextureLoad* l) noexcept	{ if (l->Uploading()) delete l; else l->Cancel(); }
     inline const CDatapak&	LoadDatapak (CGLWindow* w, goid_t cid, const GLubyte* p, GLuint psz);
     inline void			LoadBuffer (CGLWindow* w, goid_t cid, const void* data, GLuint dsz, G::BufferHint mode, G::BufferType btype);
     inline void			LoadShader (CGLWindow* w, goid_t cid, const char* v, const char* tc, const char* te, const char* g, const char* f);
@@ -60,6 +73,7 @@ private:
     inline void			LoadShader (CGLWindow* w, goid_t cid, const CDatapak& pak, const char* v, const char* f);
     inline void			LoadTexture (CGLWindow* w, goid_t cid, const GLubyte* d, GLuint dsz, G::Pixel::Fmt storeas, G::TextureType ttype);
     inline void			LoadFramebuffer (CGLWindow* w, goid_t cid, const GLubyte* d, GLuint dsz);
+    inline void			LoadVertexArray (CGLWindow* w, goid_t cid, const GLubyte* d, GLuint dsz);
     inline void			LoadFont (CGLWindow* w, goid_t cid, const GLubyte* p, GLuint psz, uint8_t fontSize);
 				// Misc
     void			AddObject (unique_ptr<CGObject> o);
@@ -73,11 +87,14 @@ private:
 				}
 private:
     bool			_authenticated	= false;
+    uint32_t			_gen		= 1;
     vector<CGObject*>		_obj;
+    vector<CTextureLoad*>	_loads;		///< Owned by the worker pool, or by this when Uploading
     argv_t			_argv;
     string			_hostname;
     uint32_t			_pid;
     uint32_t			_screen;
     static const CGLWindow*	_shwin;
     static const CIConn*	_shconn;
+    static bool			_instancedQuads;
 };
@@ -0,0 +1,181 @@
+// This file is part of the GLERI project
+//
+// Copyright (c) 2012 by Mike Sharov <msharov@users.sourceforge.net>
+// This file is free software, distributed under the MIT License.
+
+#include "iothread.h"
+#include "gob.h"
+#include "gleri/mmfile.h"
+#include <sched.h>
+
+//----------------------------------------------------------------------
+
+struct CIOThread::SConn {
+    CFile	f;
+    uint8_t*	buf;
+    uint32_t	used;
+    uint32_t	cap;
+    uint32_t	ready;	///< Size of validated complete messages at the start of buf
+    bool	fdpass;
+    bool	eof;
+    bool	closed;	///< Closing was queued
+public:
+    inline	SConn (int fd, bool fp) noexcept :f(fd),buf(nullptr),used(0),cap(0),ready(0),fdpass(fp),eof(false),closed(false) {}
+    inline	~SConn (void) noexcept	{ f.Detach(); free (buf); }
+};
+
+//----------------------------------------------------------------------
+
+CIOThread::CIOThread (void)
+: CThread()
+,_conn()
+,_input()
+,_watch()
+,_inputReady()
+,_wake()
+,_quitting (false)
+{
+}
+
+CIOThread::~CIOThread (void) noexcept
+{
+    Stop();
+    for (auto c : _conn)
+	delete c;
+    for (SInput i; _input.pop (i);)
+	free (i.data);
+}
+
+void CIOThread::Stop (void) noexcept
+{
+    __atomic_store_n (&_quitting, true, __ATOMIC_RELEASE);
+    _wake.Signal();
+    Join();
+}
+
+void CIOThread::Watch (int fd, bool canPassFd) noexcept
+{
+    SWatch w = { fd, canPassFd };
+    while (!_watch.push (w)) {
+	_wake.Signal();
+	sched_yield();
+    }
+    _wake.Signal();
+}
+
+bool CIOThread::PopInput (SInput& i) noexcept
+{
+    if (_input.empty())
+	_inputReady.Clear();	// Cleared before the last pop to not miss a signal
+    return _input.pop (i);
+}
+
+//----------------------------------------------------------------------
+
+void CIOThread::Run (void)
+{
+    vector<pollfd> pfd;
+    while (!__atomic_load_n (&_quitting, __ATOMIC_ACQUIRE)) {
+	for (SWatch w; _watch.pop (w);)
+	    _conn.push_back (new SConn (w.fd, w.fdpass));
+
+	pfd.resize (_conn.size()+1);
+	pfd[0] = { _wake.Fd(), POLLIN, 0 };
+	auto timeout = -1;
+	for (auto i = 0u; i < _conn.size(); ++i) {
+	    // Connections with unqueued data are not read until the main thread catches up
+	    auto blocked = _conn[i]->ready || _conn[i]->eof;
+	    if (blocked)
+		timeout = 1;
+	    pfd[i+1] = { _conn[i]->f.Fd(), short(blocked ? 0 : POLLIN), 0 };
+	}
+	if (0 > poll (&pfd[0], pfd.size(), timeout) && errno != EINTR)
+	    CFile::Error ("poll");
+	if (pfd[0].revents)
+	    _wake.Clear();
+
+	auto pushed = false;
+	for (auto i = 0u; i < _conn.size(); ++i) {
+	    auto& c = *_conn[i];
+	    if (pfd[i+1].revents & POLLIN)
+		ReadConn (c);
+	    else if (pfd[i+1].revents & (POLLERR| POLLHUP| POLLNVAL))
+		c.eof = true;
+	    pushed |= PushMessages (c);
+	}
+	if (pushed)
+	    _inputReady.Signal();
+
+	// The fd of a closed connection now belongs to the main thread
+	for (auto i = _conn.size(); i--;) {
+	    if (_conn[i]->closed) {
+		delete _conn[i];
+		_conn.erase (_conn.begin()+i);
+	    }
+	}
+    }
+}
+
+void CIOThread::ReadConn (SConn& c) noexcept
+{
+    try {
+	for (ssize_t br;;) {
+	    if (c.cap-c.used < 256) {
+		auto ncap = max (c.cap*2, 4096u);
+		auto nbuf = (uint8_t*) realloc (c.buf, ncap);
+		if (!nbuf) {
+		    c.eof = true;
+		    return;
+		}
+		c.buf = nbuf;
+		c.cap = ncap;
+	    }
+	    if (0 >= (br = c.f.ReadAvailable (c.buf+c.used, c.cap-c.used, c.fdpass))) {
+		c.eof |= !br;
+		break;
+	    }
+	    c.used += br;
+	}
+    } catch (XError& e) {
+	DTRACE ("[io] Read error on %d: %s\n", c.f.Fd(), e.what());
+	c.eof = true;
+    }
+}
+
+bool CIOThread::PushMessages (SConn& c) noexcept
+{
+    using SMsgHeader = CCmd::SMsgHeader;
+    while (c.used-c.ready >= sizeof(SMsgHeader)) {
+	auto& h = *reinterpret_cast<const SMsgHeader*>(c.buf+c.ready);
+	if (!h.Valid()) {	// Framing is lost; drop the connection
+	    DTRACE ("[io] Invalid message header on %d\n", c.f.Fd());
+	    c.used = c.ready;
+	    c.eof = true;
+	    break;
+	}
+	if (c.used-c.ready < h.Msgsize())
+	    break;
+	c.ready += h.Msgsize();
+    }
+    if (_input.full())
+	return false;
+    if (c.ready) {
+	// The buffer is passed on and a new one is started with the partial remainder
+	auto rem = c.used-c.ready;
+	uint8_t* nbuf = nullptr;
+	if (rem && !(nbuf = (uint8_t*) malloc (c.cap)))
+	    return false;
+	if (rem)
+	    memcpy (nbuf, c.buf+c.ready, rem);
+	_input.push (SInput { c.f.Fd(), c.ready, c.buf });
+	c.buf = nbuf;
+	c.cap = rem ? c.cap : 0;
+	c.used = rem;
+	c.ready = 0;
+	return true;
+    } else if (c.eof && !c.closed) {
+	_input.push (SInput { c.f.Fd(), 0, nullptr });
+	return c.closed = true;
+    }
+    return false;
+}
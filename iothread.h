@@ -0,0 +1,50 @@
+// This file is part of the GLERI project
+//
+// Copyright (c) 2012 by Mike Sharov <msharov@users.sourceforge.net>
+// This file is free software, distributed under the MIT License.
+
+#pragma once
+#include "gthread.h"
+#include "gleri/cmd.h"
+
+/// Reads client connections on a separate thread.
+///
+/// Incoming data is split into complete messages and their headers are
+/// validated before being passed to the main thread through a queue.
+/// The main thread owns the fds; they are never closed by this thread.
+///
+class CIOThread : public CThread {
+public:
+    /// A block of complete messages from connection fd, or its closing if data is null
+    struct SInput {
+	int		fd;
+	uint32_t	sz;
+	uint8_t*	data;
+    };
+    enum { c_MaxInput = 64, c_MaxWatch = 16 };
+public:
+			CIOThread (void);
+			~CIOThread (void) noexcept;
+    inline int		InputFd (void) const	{ return _inputReady.Fd(); }
+    void		Watch (int fd, bool canPassFd) noexcept;
+    bool		PopInput (SInput& i) noexcept;
+    void		Stop (void) noexcept;
+protected:
+    virtual void	Run (void) override;
+private:
+    struct SWatch {
+	int		fd;
+	bool		fdpass;
+    };
+    struct SConn;
+private:
+    void		ReadConn (SConn& c) noexcept;
+    bool		PushMessages (SConn& c) noexcept;
+private:
+    vector<SConn*>	_conn;		///< Owned by the I/O thread
+    CSPSCQueue<SInput,c_MaxInput>	_input;
+    CSPSCQueue<SWatch,c_MaxWatch>	_watch;
+    CWakePipe		_inputReady;	///< Signaled when _input has data
+    CWakePipe		_wake;		///< Signaled when _watch has data or on Stop
+    bool		_quitting;
+};
@@ -0,0 +1,79 @@
+// This file is part of the GLERI project
+//
+// Copyright (c) 2012 by Mike Sharov <msharov@users.sourceforge.net>
+// This file is free software, distributed under the MIT License.
+
+#pragma once
+#include "config.h"
+#include "gleri/gldefs.h"
+
+//{{{ CRecvBuf ---------------------------------------------------------
+
+/// A malloc'd block of received messages, freed with the last reference.
+/// Pending frames keep their drawlists in it instead of copying them out.
+class CRecvBuf {
+public:
+    static inline CRecvBuf*	Adopt (uint8_t* d) noexcept	{ return new CRecvBuf (d); }
+    inline void			Ref (void) noexcept		{ __atomic_add_fetch (&_refs, 1, __ATOMIC_RELAXED); }
+    inline void			Unref (void) noexcept		{ if (!__atomic_sub_fetch (&_refs, 1, __ATOMIC_ACQ_REL)) delete this; }
+    inline bool			Unique (void) const noexcept	{ return __atomic_load_n (&_refs, __ATOMIC_ACQUIRE) == 1; }
+				/// Drops the last reference, leaving the block to whoever allocated it
+    inline void			Disown (void) noexcept		{ assert (Unique()); _data = nullptr; delete this; }
+private:
+    inline explicit		CRecvBuf (uint8_t* d) noexcept	:_data(d),_refs(1) {}
+    inline			~CRecvBuf (void) noexcept	{ free (_data); }
+private:
+    uint8_t*			_data;
+    uint32_t			_refs;
+};
+
+//}}}-------------------------------------------------------------------
+//{{{ CDrawlist
+
+/// A drawlist held in a CRecvBuf
+class CDrawlist {
+public:
+    using seq_t			= uint16_t;
+public:
+    inline constexpr		CDrawlist (void) noexcept	:_buf(nullptr),_p(nullptr),_sz(0),_seq(0) {}
+				CDrawlist (const CDrawlist&) = delete;
+    inline			~CDrawlist (void) noexcept	{ clear(); }
+    void			operator= (const CDrawlist&) = delete;
+    inline bstri		Stream (void) const		{ return bstri (_p, _sz); }
+    inline bool			empty (void) const		{ return !_sz; }
+				/// Frame sequence number, counting the client's frames from 1 and skipping 0; 0 if not a frame
+    inline seq_t		Seq (void) const		{ return _seq; }
+    inline void			swap (CDrawlist& v) noexcept	{ ::swap (_buf, v._buf); ::swap (_p, v._p); ::swap (_sz, v._sz); ::swap (_seq, v._seq); }
+    inline void			clear (void) noexcept		{ if (_buf) _buf->Unref(); _buf = nullptr; _p = nullptr; _sz = 0; _seq = 0; }
+				/// References \p cmdis in \p src, or copies it if there is no \p src
+    inline void			assign (const bstri& cmdis, CRecvBuf* src, seq_t seq);
+private:
+    CRecvBuf*			_buf;
+    const uint8_t*		_p;
+    uint32_t			_sz;
+    seq_t			_seq;
+};
+
+void CDrawlist::assign (const bstri& cmdis, CRecvBuf* src, seq_t seq)
+{
+    clear();
+    _seq = seq;
+    auto sz = cmdis.remaining();
+    if (!sz)
+	return;
+    if (src) {
+	src->Ref();
+	_p = cmdis.ipos();
+    } else {
+	auto d = (uint8_t*) malloc (sz);
+	if (!d)
+	    throw XError ("failed to allocate %u bytes for a drawlist", sz);
+	memcpy (d, cmdis.ipos(), sz);
+	src = CRecvBuf::Adopt (d);
+	_p = d;
+    }
+    _buf = src;
+    _sz = sz;
+}
+
+//}}}-------------------------------------------------------------------
@@ -0,0 +1,260 @@
+// This file is part of the GLERI project
+//
+// Copyright (c) 2012 by Mike Sharov <msharov@users.sourceforge.net>
+// This file is free software, distributed under the MIT License.
+
+#include "rthread.h"
+#include "gwin.h"
+
+//{{{ CRenderResults ---------------------------------------------------
+
+void CRenderResults::Post (const SResult& r)
+{
+    _mutex.Lock();
+    _results.push_back (r);
+    _mutex.Unlock();
+    _ready.Signal();
+}
+
+void CRenderResults::Take (resultvec_t& rv) noexcept
+{
+    _ready.Clear();
+    _mutex.Lock();
+    rv.swap (_results);
+    _results.clear();
+    _mutex.Unlock();
+}
+
+//}}}-------------------------------------------------------------------
+//{{{ CRenderThread
+
+CRenderThread::CRenderThread (Display* dpy, CGLWindow& w, CRenderResults& results)
+: CThread()
+,_dpy (dpy)
+,_w (w)
+,_results (results)
+,_mutex()
+,_cond()
+,_jobs()
+,_cmds()
+,_frame()
+,_fence (nullptr)
+,_frameReq (false)
+,_paused (true)		// Created with the context current on the main thread
+,_busy (false)
+,_current (false)
+,_releaseReq (false)
+,_quitting (false)
+{
+}
+
+CRenderThread::~CRenderThread (void) noexcept
+{
+    Stop();
+    if (_fence)	// The main thread has a context current when deleting windows
+	glDeleteSync (_fence);
+}
+
+void CRenderThread::Stop (void) noexcept
+{
+    _mutex.Lock();
+    _quitting = true;
+    _cond.Broadcast();
+    _mutex.Unlock();
+    Join();
+}
+
+void CRenderThread::Post (goid_t fbid, const bstri& cmdis, CRecvBuf* src, CDrawlist::seq_t seq)
+{
+    _mutex.Lock();
+    if (fbid == G::default_Framebuffer) {	// Only the latest frame is drawn, as on the main thread
+	_w.SetPendingFrame (cmdis, src, seq);
+	_frameReq = true;
+    } else {
+	_jobs.emplace_back();
+	_jobs.back().fbid = fbid;
+	_jobs.back().data.assign (cmdis.ipos(), cmdis.end());
+    }
+    _cond.Broadcast();
+    _mutex.Unlock();
+}
+
+/// Redraws the window's last frame, as when a frame is posted
+void CRenderThread::Redraw (void) noexcept
+{
+    _mutex.Lock();
+    _w.RequestRedraw();
+    _frameReq = true;
+    _cond.Broadcast();
+    _mutex.Unlock();
+}
+
+void CRenderThread::Pause (void) noexcept
+{
+    if (_paused)
+	return;
+    DTRACE ("[%x] Pausing render thread\n", _w.IId());
+    _mutex.Lock();
+    _paused = true;
+    while (_busy)
+	_cond.Wait (_mutex);
+    _mutex.Unlock();
+}
+
+void CRenderThread::Resume (void) noexcept
+{
+    if (!_paused)
+	return;
+    DTRACE ("[%x] Resuming render thread\n", _w.IId());
+    _mutex.Lock();
+    _paused = false;
+    _cond.Broadcast();
+    _mutex.Unlock();
+}
+
+void CRenderThread::AcquireContext (void) noexcept
+{
+    assert (_paused && "Pause the render thread before acquiring its context");
+    _mutex.Lock();
+    if (_current) {
+	_releaseReq = true;
+	_cond.Broadcast();
+	while (_releaseReq)
+	    _cond.Wait (_mutex);
+    }
+    _mutex.Unlock();
+}
+
+void CRenderThread::SetFence (GLsync fence) noexcept
+{
+    _mutex.Lock();
+    if (_fence)	// Superseded by the new fence, which is later on the main thread
+	glDeleteSync (_fence);
+    _fence = fence;
+    _mutex.Unlock();
+}
+
+void CRenderThread::PostEvent (const CEvent& e)
+{
+    _results.Post (CRenderResults::SResult { _w.Fd(), _w.IId(), e, string() });
+}
+
+//----------------------------------------------------------------------
+
+void CRenderThread::Run (void)
+{
+    uint64_t nextPoll = 0;
+    _mutex.Lock();
+    while (!_quitting) {
+	if (_releaseReq) {
+	    if (_current) {
+		_w.Deactivate();
+		glXMakeCurrent (_dpy, None, nullptr);
+		_current = false;
+	    }
+	    _releaseReq = false;
+	    _cond.Broadcast();
+	}
+	auto due = _w.NextFrameTime();
+	if (_paused)
+	    _cond.Wait (_mutex);
+	else if (!_jobs.empty()) {
+	    auto fbid = _jobs.front().fbid;
+	    _cmds.swap (_jobs.front().data);
+	    _jobs.erase (_jobs.begin());
+	    Execute (fbid);
+	} else if (due != CApp::NoTimer ? due <= CApp::NowMS() : _frameReq) {
+	    // Either a new frame or the vsync of the last one, same as CGleris::RunFrameClock
+	    _w.TakePendingFrame (_frame);
+	    _frameReq = false;
+	    Execute (G::default_Framebuffer);
+	} else {
+	    // SaveFramebuffer readbacks are polled until complete
+	    auto wake = due;
+	    if (_w.ReadbacksPending()) {
+		auto now = CApp::NowMS();
+		if (nextPoll <= now) {
+		    PollReadbacks();
+		    nextPoll = now + CGLWindow::c_ReadbackPollMS;
+		    continue;	// State may have changed while unlocked
+		}
+		wake = min (wake, nextPoll);
+	    }
+	    if (wake != CApp::NoTimer)
+		_cond.WaitUntil (_mutex, wake);
+	    else
+		_cond.Wait (_mutex);
+	}
+    }
+    if (_current) {
+	glXMakeCurrent (_dpy, None, nullptr);
+	_current = false;
+    }
+    _mutex.Unlock();
+}
+
+// Called with _mutex locked, which is released while drawing
+void CRenderThread::Execute (goid_t fbid) noexcept
+{
+    _busy = true;
+    auto fence = _fence;
+    _fence = nullptr;
+    _mutex.Unlock();
+    auto frameDone = true;
+    try {
+	MakeCurrent();
+	if (fence) {
+	    glWaitSync (fence, 0, GL_TIMEOUT_IGNORED);
+	    glDeleteSync (fence);
+	}
+	if (fbid != G::default_Framebuffer)
+	    _w.ParseDrawlist (fbid, bstri (_cmds.data(), _cmds.size()));
+	else if ((frameDone = _w.PollFrame (_dpy)))
+	    _w.DrawFrame (_frame, _dpy);
+	_w.CheckForErrors();
+    } catch (XError& e) {
+	PostError (e);
+    }
+    _mutex.Lock();
+    if (!frameDone)	// Put back to draw when the last frame is done
+	_w.RestorePendingFrame (_frame);
+    _frame.clear();
+    _busy = false;
+    _cond.Broadcast();
+}
+
+// Called with _mutex locked, same as Execute
+void CRenderThread::PollReadbacks (void) noexcept
+{
+    _busy = true;
+    _mutex.Unlock();
+    try {
+	MakeCurrent();
+	_w.FinishReadbacks();
+    } catch (XError& e) {
+	PostError (e);
+    }
+    _mutex.Lock();
+    _busy = false;
+    _cond.Broadcast();
+}
+
+void CRenderThread::MakeCurrent (void)
+{
+    if (_current)
+	return;
+    DTRACE ("[%x] Render thread activating context %x\n", _w.IId(), _w.ContextId());
+    glXMakeCurrent (_dpy, _w.Drawable(), _w.ContextId());
+    _current = true;
+    _w.Activate();
+}
+
+void CRenderThread::PostError (const XError& e) noexcept
+{
+    DTRACE ("[%x] Render thread error: %s\n", _w.IId(), e.what());
+    try {
+	_results.Post (CRenderResults::SResult { _w.Fd(), _w.IId(), CEvent(), e.what() });
+    } catch (...) {}
+}
+
+//}}}-------------------------------------------------------------------
@@ -0,0 +1,92 @@
+// This file is part of the GLERI project
+//
+// Copyright (c) 2012 by Mike Sharov <msharov@users.sourceforge.net>
+// This file is free software, distributed under the MIT License.
+
+#pragma once
+#include "gthread.h"
+#include "gob.h"
+#include "gleri/event.h"
+#include "recvbuf.h"
+
+class CGLWindow;
+
+//{{{ CRenderResults ---------------------------------------------------
+
+/// Events and errors from render threads, to be forwarded by the main thread
+class CRenderResults {
+public:
+    struct SResult {
+	int		fd;
+	uint16_t	iid;
+	CEvent		e;
+	string		error;	///< If not empty, the drawlist failed with this error
+    };
+    using resultvec_t	= vector<SResult>;
+public:
+    inline		CRenderResults (void)	:_mutex(),_results(),_ready() {}
+    inline int		Fd (void) const		{ return _ready.Fd(); }
+    void		Post (const SResult& r);
+    void		Take (resultvec_t& rv) noexcept;
+private:
+    CMutex		_mutex;
+    resultvec_t		_results;
+    CWakePipe		_ready;
+};
+
+//}}}-------------------------------------------------------------------
+//{{{ CRenderThread
+
+/// Draws a window's drawlists on a separate thread, with its context bound there.
+///
+/// The main thread must Pause the thread before changing resources it may
+/// use, and AcquireContext before making the window's context current.
+/// Changes made in other contexts are waited for with the fence given to
+/// SetFence before drawing resumes.
+///
+class CRenderThread : public CThread {
+public:
+    using goid_t	= G::goid_t;
+public:
+			CRenderThread (Display* dpy, CGLWindow& w, CRenderResults& results);
+			~CRenderThread (void) noexcept;
+    void		Stop (void) noexcept;
+    void		Post (goid_t fbid, const bstri& cmdis, CRecvBuf* src, CDrawlist::seq_t seq);
+    void		Redraw (void) noexcept;
+    inline bool		Paused (void) const	{ return _paused; }
+    void		Pause (void) noexcept;
+    void		Resume (void) noexcept;
+    void		AcquireContext (void) noexcept;
+    void		SetFence (GLsync fence) noexcept;
+    void		PostEvent (const CEvent& e);
+protected:
+    virtual void	Run (void) override;
+private:
+    struct SJob {
+	goid_t		fbid;
+	vector<GLubyte>	data;
+    };
+private:
+    void		Execute (goid_t fbid) noexcept;
+    void		PollReadbacks (void) noexcept;
+    void		MakeCurrent (void);
+    void		PostError (const XError& e) noexcept;
+private:
+    Display*		_dpy;
+    CGLWindow&		_w;
+    CRenderResults&	_results;
+    CMutex		_mutex;
+    CCondition		_cond;
+    vector<SJob>	_jobs;		///< Drawlists for offscreen framebuffers
+    vector<GLubyte>	_cmds;		///< Offscreen drawlist being executed
+    CDrawlist		_frame;		///< Window frame being executed
+    GLsync		_fence;
+    bool		_frameReq;	///< A frame was posted; the drawlist is the window's pending frame
+    bool		_paused;
+    bool		_busy;
+    bool		_current;	///< The window's context is current on this thread
+    bool		_releaseReq;
+    bool		_quitting;
+};
+
+//}}}-------------------------------------------------------------------
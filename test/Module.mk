@@ -20,6 +20,9 @@ test/check:	${test/EXE} ${EXE}
 	@echo "Running $<"; \
 	PATH="$O" ./${test/EXE} > ${test/EXE}.out 2>&1; \
 	diff test/${test/NAME}.std ${test/EXE}.out && rm -f ${test/EXE}.out
+	@echo "Running $< with geometry shader quads"; \
+	GLERI_GEOMETRY_QUADS=1 PATH="$O" ./${test/EXE} > ${test/EXE}.out 2>&1; \
+	diff test/${test/NAME}.std ${test/EXE}.out && rm -f ${test/EXE}.out
 
 ${test/EXE}:	${test/OBJS} ${EXE} ${LIBA}
 	@echo "Linking $@ ..."
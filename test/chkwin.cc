@@ -0,0 +1,385 @@
+// This file is part of the GLERI project
+//
+// Copyright (c) 2012 by Mike Sharov <msharov@users.sourceforge.net>
+// This file is free software, distributed under the MIT License.
+
+#include "chkwin.h"
+#include "twin.h"
+
+//{{{ Vertex data ------------------------------------------------------
+namespace {
+
+static const CCheckWindow::coord_t c_Rects[] = {
+    VGEN_TFRECT (8,56, 40,40),
+    VGEN_TFRECT (0,0, 40,40),
+    VGEN_TFRECT (112,56, 40,40),
+    VGEN_TFRECT (200,8, 40,40),
+    VGEN_TFRECT (152,8, 40,40),
+    VGEN_TFRECT (8,8, 40,40),
+    VGEN_TFRECT (56,8, 40,40),
+    VGEN_TFRECT (104,8, 40,40)
+};
+enum {
+    VRENUM (AnimColor, 4),
+    VRENUM (AnimOffset, 4),
+    VRENUM (AnimUniform, 4),
+    VRENUM (Tint, 4),
+    VRENUM (VertexArray, 4),
+    VRENUM (Merged, 12)
+};
+static constexpr const CCheckWindow::color_t c_MergedColors[] = {
+    RGB(255,0,0), RGB(0,255,0), RGB(0,0,255)
+};
+enum {
+    sprite_W = 16,
+    sprite_H = sprite_W
+};
+static constexpr const CCheckWindow::color_t c_SpriteColors[] = {
+    RGB(255,0,128), RGB(0,128,255)
+};
+
+//}}}-------------------------------------------------------------------
+//{{{ Color shader, with plain uniforms
+
+static const char c_colorShader_v[] =
+"#version 330 core\n"
+"\n"
+"uniform mat4 Transform;\n"
+"layout(location=0) in vec2 Vertex;\n"
+"\n"
+"void main() {\n"
+"    gl_Position = Transform*vec4(Vertex,1,1);\n"
+"}";
+
+static const char c_colorShader_f[] =
+"#version 330 core\n"
+"\n"
+"uniform vec4 Color;\n"
+"out vec4 FragColor;\n"
+"\n"
+"void main() {\n"
+"    FragColor = Color;\n"
+"}";
+
+static const float c_AnimColor1[4] = { 0, 1, 0, 1 }, c_AnimColor2[4] = { 0, 0.5f, 0, 1 };
+
+//}}}-------------------------------------------------------------------
+//{{{ Tint shader, colored from a client uniform buffer
+
+static const char c_tintShader_v[] =
+"#version 330 core\n"
+"\n"
+"layout(std140) uniform DrawState { mat4 Transform; vec4 Color; vec4 Viewport; };\n"
+"layout(location=0) in vec2 Vertex;\n"
+"\n"
+"void main() {\n"
+"    gl_Position = Transform*vec4(Vertex,1,1);\n"
+"}";
+
+static const char c_tintShader_f[] =
+"#version 330 core\n"
+"\n"
+"layout(std140) uniform Tint { vec4 TintColor; };\n"
+"out vec4 FragColor;\n"
+"\n"
+"void main() {\n"
+"    FragColor = TintColor;\n"
+"}";
+
+static const float c_Tint[4] = { 1, 0.5f, 0, 1 };
+
+//}}}-------------------------------------------------------------------
+//{{{ CReadback
+
+/// Pixels read back from the check framebuffer, in bottom-up RGB rows
+class CReadback {
+public:
+    using coord_t	= CCheckWindow::coord_t;
+    using dim_t		= CCheckWindow::dim_t;
+    using color_t	= CCheckWindow::color_t;
+    enum { c_Tolerance = 4 };
+public:
+    explicit		CReadback (const uint8_t* p)	:_p(p) {}
+    bool		PixelIs (coord_t x, coord_t y, color_t c1, color_t c2) const;
+    inline bool		PixelIs (coord_t x, coord_t y, color_t c) const	{ return PixelIs (x, y, c, c); }
+    bool		AreaHas (coord_t x, coord_t y, dim_t w, dim_t h, color_t c) const;
+private:
+    inline const uint8_t* Pixel (coord_t x, coord_t y) const	{ return &_p[((CCheckWindow::c_Height-1-y)*CCheckWindow::c_Width+x)*3]; }
+    static bool		Between (const uint8_t* p, color_t c1, color_t c2);
+private:
+    const uint8_t*	_p;
+};
+
+/// Returns true if each component of \p p is between those of \p c1 and \p c2
+bool CReadback::Between (const uint8_t* p, color_t c1, color_t c2) // static
+{
+    for (auto i = 0u; i < 3; ++i, c1 >>= 8, c2 >>= 8) {
+	int v1 = uint8_t(c1), v2 = uint8_t(c2);
+	if (p[i] + c_Tolerance < min (v1, v2) || p[i] > max (v1, v2) + c_Tolerance)
+	    return false;
+    }
+    return true;
+}
+
+bool CReadback::PixelIs (coord_t x, coord_t y, color_t c1, color_t c2) const
+{
+    auto p = Pixel (x, y);
+    if (Between (p, c1, c2))
+	return true;
+    printf ("Pixel %hd,%hd is %02x%02x%02x\n", x, y, p[0], p[1], p[2]);
+    return false;
+}
+
+/// Returns true if any pixel in the given area is \p c
+bool CReadback::AreaHas (coord_t x, coord_t y, dim_t w, dim_t h, color_t c) const
+{
+    for (auto py = y; py < y+h; ++py)
+	for (auto px = x; px < x+w; ++px)
+	    if (Between (Pixel (px, py), c, c))
+		return true;
+    printf ("No pixel in %hux%hu+%hd+%hd is %02x%02x%02x\n", w, h, x, y, uint8_t(c), uint8_t(c>>8), uint8_t(c>>16));
+    return false;
+}
+
+static void Report (const char* name, bool ok)
+{
+    if (ok)
+	printf ("Checked %s\n", name);
+    else
+	printf ("Check of %s failed\n", name);
+}
+
+/// Checks that \p filename is a Y4M capture of at least \p nFrames frames
+static bool CheckCapture (const char* filename, unsigned nFrames)
+{
+    CMMFile f;
+    try {
+	f.Open (filename);
+    } catch (XError& e) {
+	printf ("Capture %s could not be read: %s\n", filename, e.what());
+	return false;
+    }
+    unlink (filename);
+    auto p = reinterpret_cast<const char*>(f.MMData());
+    auto hdrend = static_cast<const char*>(memchr (p, '\n', f.MMSize()));
+    unsigned w = 0, h = 0;
+    if (!hdrend || 2 != sscanf (p, "YUV4MPEG2 W%u H%u", &w, &h) || !w || !h) {
+	printf ("Capture %s has no Y4M header\n", filename);
+	return false;
+    }
+    static const char c_FrameHeader[] = "FRAME\n";
+    auto framesz = strlen(c_FrameHeader) + 3*w*h;
+    auto datasz = f.MMSize() - (hdrend+1-p);
+    if (datasz % framesz || datasz / framesz < nFrames || memcmp (hdrend+1, c_FrameHeader, strlen(c_FrameHeader))) {
+	printf ("Capture %s has %zu bytes of data, not %u frames of %ux%u\n", filename, datasz, nFrames, w, h);
+	return false;
+    }
+    return true;
+}
+
+} // namespace
+//}}}-------------------------------------------------------------------
+
+CCheckWindow::CCheckWindow (iid_t wid)
+: CWindow(wid)
+,_vbuf(0)
+,_col(0)
+,_fb(0)
+,_colorShader(0)
+,_tintShader(0)
+,_tintbuf(0)
+,_va(0)
+,_sprites(0)
+,_spritesInfo()
+,_capturedFrames(0)
+,_started(false)
+{
+    const char* tmpdir = getenv ("TMPDIR");
+    if (!tmpdir)
+	tmpdir = "/tmp";
+    snprintf (ArrayBlock(_rbfile), "%s/gltest%u.gltx", tmpdir, unsigned(getpid()));
+    snprintf (ArrayBlock(_capfile), "%s/gltest%u.y4m", tmpdir, unsigned(getpid()));
+}
+
+void CCheckWindow::OnInit (void)
+{
+    CWindow::OnInit();
+    // Runs of flat draws are merged into one multidraw where OpenGL 4.3 is available
+    Open ("GLERI Test Checks", WinInfo (0, 0, c_Width, c_Height, 0, 0x33, 0x46, WinInfo::MSAA_OFF,
+		WinInfo::type_Normal, WinInfo::state_Normal, WinInfo::flag_None, WinInfo::rflag_MergeDraws));
+    Capture (_capfile);
+    _vbuf = BufferData (G::ARRAY_BUFFER, c_Rects, sizeof(c_Rects));
+    _col = CreateTexture (G::TEXTURE_2D, c_Width, c_Height, 0, G::Pixel::RGBA);
+    _fb = CreateFramebuffer ({{G::FRAMEBUFFER, G::COLOR_ATTACHMENT0, G::TEXTURE_2D, 0, _col}});
+    _colorShader = LoadShader (c_colorShader_v, c_colorShader_f);
+    _tintShader = LoadShader (c_tintShader_v, c_tintShader_f);
+    _tintbuf = BufferData (G::UNIFORM_BUFFER, c_Tint, sizeof(c_Tint));
+    _va = CreateVertexArray ({ G::VertexAttrib (0, _vbuf, G::SHORT, 2, v_VertexArrayOffset*(2*sizeof(short))) });
+
+    // Two sprites side by side, each a solid color, to check the source rects
+    struct {
+	G::Texture::GLTXHeader	h;
+	uint8_t			p [sprite_H][sprite_W*ArraySize(c_SpriteColors)][4];
+    } sprites;
+    sprites.h = G::Texture::GLTXHeader (G::Texture::TEXTURE_2D, sprite_W*ArraySize(c_SpriteColors), sprite_H);
+    sprites.h.info.nImages = 1;
+    sprites.h.info.size = sizeof(sprites.p);
+    for (auto y = 0u; y < sprite_H; ++y)
+	for (auto x = 0u; x < ArraySize(sprites.p[y]); ++x)
+	    for (auto i = 0u; i < 4; ++i)
+		sprites.p[y][x][i] = c_SpriteColors[x/sprite_W] >> (i*8);
+    _sprites = LoadTexture (G::TEXTURE_2D, &sprites, sizeof(sprites));
+}
+
+void CCheckWindow::OnResize (dim_t w, dim_t h)
+{
+    CWindow::OnResize (w,h);
+    if (_started)
+	return;
+    _started = true;
+    Draw();
+}
+
+void CCheckWindow::OnEvent (const CEvent& e)
+{
+    CWindow::OnEvent (e);
+    if (e.type != CEvent::VSync || !e.x || _capturedFrames >= c_CaptureFrames)
+	return;	// Redraws have no frame sequence number
+    if (++_capturedFrames < c_CaptureFrames)
+	Draw();
+    else {
+	StopCapture();
+	DrawChecks (_fb);
+    }
+}
+
+ONDRAWIMPL(CCheckWindow)::OnDraw (Drw& drw) const
+{
+    CWindow::OnDraw (drw);
+    drw.Clear (RGB(0,0,64));
+    drw.Image (0, 0, _col);
+}
+
+DRAWFBIMPL(CCheckWindow,Checks)
+{
+    drw.Clear (RGB(0,0,0));
+    drw.VertexPointer (_vbuf);
+
+    // At any time, animations are between their endpoints
+    drw.AnimateColor (RGB(200,0,0), RGB(0,0,200), 2000, G::Animation::PINGPONG);
+    drw.TriangleFan (v_AnimColorOffset, v_AnimColorSize);
+    drw.Color (255,255,255);
+    drw.AnimateOffset (56, 56, 64, 56, 1000, G::Animation::PINGPONG);
+    drw.TriangleFan (v_AnimOffsetOffset, v_AnimOffsetSize);
+    drw.Offset (0, 0);
+    drw.Shader (_colorShader);
+    drw.AnimateUniform ("Color", c_AnimColor1, c_AnimColor2, 3000, G::Animation::PINGPONG);
+    drw.TriangleFan (v_AnimUniformOffset, v_AnimUniformSize);
+
+    drw.Shader (_tintShader);
+    drw.UniformBuffer ("Tint", G::ubo_ClientFirst, _tintbuf);
+    drw.TriangleFan (v_TintOffset, v_TintSize);
+    drw.DefaultShader();
+
+    drw.Color (255,255,0);
+    drw.VertexArray (_va);
+    drw.TriangleFan (0, v_VertexArraySize);
+    drw.DefaultVertexArray();
+
+    for (auto i = 0u; i < ArraySize(c_MergedColors); ++i) {
+	drw.Color (c_MergedColors[i]);
+	drw.TriangleFan (v_MergedOffset+i*4, 4);
+    }
+
+    const typename Drw::SpriteRect sprites[] = {
+	{ 8, 104, 0, 0, sprite_W, sprite_H },
+	{ 32, 104, sprite_W, 0, sprite_W, sprite_H }
+    };
+    drw.Sprites (_sprites, ArrayBlock(sprites));
+
+    // Glyph edges are antialiased, so only some pixels are the full color
+    drw.Color (255,255,255);
+    drw.Text (8, 136, "MMMM");
+
+    drw.SaveFramebuffer (0, 0, c_Width, c_Height, _rbfile, G::Texture::Format::GLTX);
+}
+
+void CCheckWindow::OnTextureInfo (goid_t id, const G::Texture::Info& info)
+{
+    CWindow::OnTextureInfo (id, info);
+    if (id == _sprites)
+	_spritesInfo = info;
+}
+
+void CCheckWindow::OnSaveFramebuffer (goid_t id, CFile& f)
+{
+    CWindow::OnSaveFramebuffer (id, f);
+    if (id != _fb)
+	return;
+    CMMFile rbf (_rbfile);
+    unlink (_rbfile);
+    auto& h = *reinterpret_cast<const G::Texture::GLTXHeader*>(rbf.MMData());
+    if (rbf.MMSize() < sizeof(h) || h.magic != h.Magic
+	    || h.info.w != c_Width || h.info.h != c_Height
+	    || rbf.MMSize() < h.dataOffset + c_Width*3u*c_Height)
+	printf ("Readback of %s is not a %ux%u GLTX image\n", _rbfile, c_Width, c_Height);
+    else {
+	const CReadback img (rbf.MMData() + h.dataOffset);
+	Report ("animations", img.PixelIs (28, 76, RGB(200,0,0), RGB(0,0,200))
+			    && img.PixelIs (80, 76, RGB(255,255,255))
+			    && img.PixelIs (132, 76, RGB(0,255,0), RGB(0,128,0)));
+	Report ("uniform buffer", img.PixelIs (220, 28, RGB(255,128,0)));
+	Report ("vertex array", img.PixelIs (172, 28, RGB(255,255,0)));
+	Report ("merged draws", img.PixelIs (28, 28, c_MergedColors[0])
+			    && img.PixelIs (76, 28, c_MergedColors[1])
+			    && img.PixelIs (124, 28, c_MergedColors[2]));
+	Report ("sprites", _spritesInfo.w == sprite_W*ArraySize(c_SpriteColors) && _spritesInfo.h == sprite_H
+			    && img.PixelIs (16, 112, c_SpriteColors[0])
+			    && img.PixelIs (40, 112, c_SpriteColors[1]));
+	Report ("text", img.AreaHas (8, 136, 64, 24, RGB(255,255,255)));
+	Report ("capture", CheckCapture (_capfile, c_CaptureFrames));
+    }
+    FinishChecks();
+}
+
+void CCheckWindow::FinishChecks (void)
+{
+    CGLApp::Instance().CreateWindow<CPresentWindow>();
+    Close();
+}
+
+//----------------------------------------------------------------------
+
+void CPresentWindow::OnInit (void)
+{
+    CWindow::OnInit();
+    Open ("GLERI Test Present Mode", 64, 64);
+    SetPresentMode (G::PresentMode::IMMEDIATE);
+}
+
+void CPresentWindow::OnResize (dim_t w, dim_t h)
+{
+    CWindow::OnResize (w,h);
+    Draw();
+}
+
+ONDRAWIMPL(CPresentWindow)::OnDraw (Drw& drw) const
+{
+    CWindow::OnDraw (drw);
+    drw.Clear (RGB(0,0,64));
+}
+
+void CPresentWindow::OnEvent (const CEvent& e)
+{
+    CWindow::OnEvent (e);
+    if (e.type != CEvent::VSync || !e.x || _checked)
+	return;	// The PresentMode event precedes the first frame
+    _checked = true;
+    // Servers without a way to turn off vsync fall back to VSYNC
+    if (PresentMode() == G::PresentMode::IMMEDIATE || PresentMode() == G::PresentMode::VSYNC)
+	printf ("Checked present mode\n");
+    else
+	printf ("Present mode %u is not immediate or its fallback\n", unsigned(PresentMode()));
+    CGLApp::Instance().CreateWindow<CTestWindow>();
+    Close();
+}
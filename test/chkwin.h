@@ -0,0 +1,54 @@
+// This file is part of the GLERI project
+//
+// Copyright (c) 2012 by Mike Sharov <msharov@users.sourceforge.net>
+// This file is free software, distributed under the MIT License.
+
+#pragma once
+#include "../gleri.h"
+
+/// Draws features into a framebuffer, reads it back, and checks the pixels.
+/// The first frames are captured and checked too.
+/// When done, opens the interactive test window.
+class CCheckWindow : public CWindow {
+public:
+    enum { c_Width = 256, c_Height = c_Width, c_CaptureFrames = 3 };
+public:
+    explicit		CCheckWindow (iid_t wid);
+    virtual void	OnInit (void) override;
+    virtual void	OnResize (dim_t w, dim_t h) override;
+    virtual void	OnEvent (const CEvent& e) override;
+    ONDRAWDECL		OnDraw (Drw& drw) const;
+			DRAWFBDECL(Checks);
+protected:
+    virtual void	OnTextureInfo (goid_t id, const G::Texture::Info& info) override;
+    virtual void	OnSaveFramebuffer (goid_t id, CFile& f) override;
+private:
+    void		FinishChecks (void);
+private:
+    goid_t		_vbuf;
+    goid_t		_col;
+    goid_t		_fb;
+    goid_t		_colorShader;
+    goid_t		_tintShader;
+    goid_t		_tintbuf;
+    goid_t		_va;
+    goid_t		_sprites;
+    G::Texture::Info	_spritesInfo;	///< As reported by the server
+    unsigned		_capturedFrames;
+    bool		_started;
+    char		_rbfile [PATH_MAX];	///< Readback of _fb
+    char		_capfile [PATH_MAX];	///< Capture of the first frames
+};
+
+/// Requests immediate presentation and checks the mode the server reports,
+/// which may be its VSYNC fallback. When done, opens the interactive test window.
+class CPresentWindow : public CWindow {
+public:
+    explicit		CPresentWindow (iid_t wid)	: CWindow(wid),_checked(false) {}
+    virtual void	OnInit (void) override;
+    virtual void	OnResize (dim_t w, dim_t h) override;
+    virtual void	OnEvent (const CEvent& e) override;
+    ONDRAWDECL		OnDraw (Drw& drw) const;
+private:
+    bool		_checked;
+};
@@ -3,7 +3,7 @@
 // Copyright (c) 2012 by Mike Sharov <msharov@users.sourceforge.net>
 // This file is free software, distributed under the MIT License.
 
-#include "twin.h"
+#include "chkwin.h"
 
 class CGLTest : public CGLApp {
 public:
@@ -16,7 +16,7 @@ public:
 	if (argc > 1 && argv[1][0] == '-' && argv[1][1] == 'c')
 	    st = server_Local;
 	CGLApp::Init (argc, argv, st);
-	CreateWindow<CTestWindow>();
+	CreateWindow<CCheckWindow>();
     }
 };
 
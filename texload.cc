@@ -0,0 +1,94 @@
+// This file is part of the GLERI project
+//
+// Copyright (c) 2012 by Mike Sharov <msharov@users.sourceforge.net>
+// This file is free software, distributed under the MIT License.
+
+#include "texload.h"
+#include "gleris.h"
+
+CTextureLoad::CTextureLoad (CGLWindow* w, CTexture* t, const GLubyte* p, GLuint psz, G::Pixel::Fmt storeas, G::TextureType ttype, const CTexture::CParam& param)
+: CJob()
+,_w (w)
+,_t (t)
+,_data (p, p+psz)
+,_tbuf()
+,_error()
+,_param (param)
+,_storeas (storeas)
+,_ttype (ttype)
+,_upy (0)
+,_upid (0)
+{
+}
+
+CTextureLoad::~CTextureLoad (void) noexcept
+{
+    if (_upid)	// Cancelled while uploading
+	glDeleteTextures (1, &_upid);
+}
+
+void CTextureLoad::Run (void) noexcept
+{
+    try {
+	_tbuf = CTexture::Decode (&_data[0], _data.size());
+    } catch (XError& e) {
+	_error = e.what();
+    }
+    _data.clear();
+    _data.shrink_to_fit();
+}
+
+bool CTextureLoad::Finish (void) noexcept
+{
+    if (!_w)
+	return true;	// Cancelled
+    auto w = _w;
+    try {
+	if (!_error.empty())
+	    throw XError ("%s", _error.c_str());
+	auto& app = CGleris::Instance();
+	app.ActivateForSharedObjects (*w);
+	if (!MustWait() && _tbuf.Size() > c_SliceSize && (_upid = _t->BeginUpload (_tbuf, _storeas, _ttype, _param))) {
+	    DTRACE ("[%x] Uploading decoded texture %x in slices\n", w->IId(), CId());
+	    app.ScheduleUploads();
+	    return false;	// Kept in the connection's loads until uploaded
+	}
+	DTRACE ("[%x] Uploading decoded texture %x\n", w->IId(), CId());
+	w->EndLoad (this);
+	_t->Create (_tbuf, _storeas, _ttype, _param, true);
+	Uploaded();
+    } catch (XError& e) {
+	w->EndLoad (this);
+	CGleris::Instance().ForwardError ("LoadData", e, w->Fd(), w->IId());
+    }
+    return true;
+}
+
+/// Uploads the next slice of the image. Returns true when done, and the
+/// caller must then remove the job from its window's loads and delete it.
+bool CTextureLoad::UploadSlice (void) noexcept
+{
+    auto w = _w;
+    try {
+	CGleris::Instance().ActivateForSharedObjects (*w);
+	auto& ti = _tbuf.Info();
+	auto rowsz = G::Pixel::TextureSize (ti.fmt, ti.comp, ti.w, 1);
+	auto nrows = GLushort (min<size_t> (ti.h-_upy, max<size_t> (1, c_SliceSize/rowsz)));
+	_t->UploadRows (_upid, _tbuf, _upy, nrows);
+	if ((_upy += nrows) < ti.h)
+	    return false;
+	DTRACE ("[%x] Uploaded last slice of texture %x\n", w->IId(), CId());
+	_t->EndUpload (_upid, _tbuf);
+	_upid = 0;
+	Uploaded();
+    } catch (XError& e) {
+	CGleris::Instance().ForwardError ("LoadData", e, w->Fd(), w->IId());
+    }
+    return true;
+}
+
+void CTextureLoad::Uploaded (void)
+{
+    _w->CheckForErrors();
+    _w->ResourceInfo (CId(), uint16_t(PRGL::ResourceFromTextureType(_ttype)), _t->Info());
+}
@@ -0,0 +1,49 @@
+// This file is part of the GLERI project
+//
+// Copyright (c) 2012 by Mike Sharov <msharov@users.sourceforge.net>
+// This file is free software, distributed under the MIT License.
+
+#pragma once
+#include "gthread.h"
+#include "gotex.h"
+
+class CGLWindow;
+
+/// Decodes an image file on a worker thread and uploads it into a
+/// placeholder texture when done. The texture info is sent to the client
+/// only after the upload. Cancelled when the texture or its window is freed.
+///
+/// Large images not waited for are uploaded c_SliceSize bytes per frame
+/// clock tick, with the job then owned by the connection until done.
+///
+class CTextureLoad : public CWorkerPool::CJob {
+public:
+    enum {
+	c_SliceSize = 1u<<20,
+	c_SliceIntervalMS = 16	///< Between slices, when no window is drawing
+    };
+public:
+			CTextureLoad (CGLWindow* w, CTexture* t, const GLubyte* p, GLuint psz, G::Pixel::Fmt storeas, G::TextureType ttype, const CTexture::CParam& param);
+			~CTextureLoad (void) noexcept;
+    inline G::goid_t	CId (void) const	{ return _t->CId(); }
+    inline const CGLWindow* Window (void) const	{ return _w; }
+    inline bool		MustWait (void) const	{ return _param.Get (_ttype, G::Texture::LOAD_MODE) == G::Texture::LOAD_WAIT; }
+    inline void		Cancel (void)		{ _w = nullptr; }
+    inline bool		Uploading (void) const	{ return _upid; }
+    virtual void	Run (void) noexcept override;
+    virtual bool	Finish (void) noexcept override;
+    bool		UploadSlice (void) noexcept;
+private:
+    void		Uploaded (void);
+private:
+    CGLWindow*		_w;
+    CTexture*		_t;
+    vector<GLubyte>	_data;
+    CTexture::CTexBuf	_tbuf;
+    string		_error;
+    CTexture::CParam	_param;
+    G::Pixel::Fmt	_storeas;
+    G::TextureType	_ttype;
+    GLushort		_upy;	///< Rows uploaded
+    GLuint		_upid;	///< Texture being uploaded in slices
+};
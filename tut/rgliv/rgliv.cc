@@ -146,6 +146,8 @@ void CImageViewer::OnInit (void)
     Open ("GLERI Image Viewer", WinInfo (0,0,800,600,0,0x33,0,WinInfo::MSAA_OFF,WinInfo::type_Normal,WinInfo::state_Fullscreen));
     TexParameter (G::Texture::MIN_FILTER, G::Texture::LINEAR);	// Enable linear texture filtering;
     TexParameter (G::Texture::MAG_FILTER, G::Texture::LINEAR);	//  it helps eliminate hard pixel boundaries.
+    TexParameter (G::Texture::LOAD_MODE, G::Texture::LOAD_PLACEHOLDER);	// Images are used only after OnTextureInfo,
+										//  so they can be decoded in the background.
     // Drawing and loading calls can be made henceforth
 
     // Primitives are always drawn from vertex buffers, created before